@@ -0,0 +1,77 @@
+#include "camera.hpp"
+
+// std
+#include <array>
+
+camera_2d::camera_2d(int width, int height) noexcept
+:   width{width}
+,   height{height}
+,   centre{width * 0.5f, height * 0.5f}
+,   zoom{1.0f} {
+
+}
+
+void camera_2d::pan(float screen_dx, float screen_dy) noexcept {
+    // dragging the picture right moves the camera left
+    centre -= djc::math::vec2f(screen_dx, screen_dy) / zoom;
+    clamp();
+}
+
+void camera_2d::zoom_at(float factor, float screen_x, float screen_y) noexcept {
+    djc::math::vec2f from_middle(screen_x - width * 0.5f, screen_y - height * 0.5f);
+    djc::math::vec2f under_cursor = centre + from_middle / zoom;
+
+    zoom = std::clamp(zoom * factor, 1.0f, max_zoom);
+    centre = under_cursor - from_middle / zoom;
+    clamp();
+}
+
+void camera_2d::reset() noexcept {
+    centre = djc::math::vec2f(width * 0.5f, height * 0.5f);
+    zoom = 1.0f;
+}
+
+bool camera_2d::is_identity() const noexcept {
+    return zoom == 1.0f; // clamp() keeps the centre in the middle at 1
+}
+
+screen_transform camera_2d::transform() const noexcept {
+    // exactly 1:1, not 1:1 give or take the rounding of three matrix products
+    if (is_identity()) {
+        return screen_transform{1.0f, 1.0f, 0.0f, 0.0f};
+    }
+
+    using namespace djc::math;
+    int half_width = width / 2;
+    int half_height = height / 2;
+
+    // row vector layout like the two helpers - zoom, flip y up, centre to the origin
+    mat4f view(std::array<float, 16>{{
+        zoom,                0,                   0, 0,
+        0,                   -zoom,               0, 0,
+        0,                   0,                   1, 0,
+        -centre.x * zoom,    centre.y * zoom,     0, 1
+    }});
+
+    mat4f projection = create_mat4_orthographic_matrix<float>(half_width, half_height, -1.0f, 1.0f);
+    mat4f screen = create_mat4_screenspace_transform<float>(static_cast<float>(half_width), static_cast<float>(half_height));
+    mat4f combined = view * projection * screen;
+
+    // a column of the storage is what a row vector's x (or y) is made of
+    vec4f x_terms = combined * vec4f(1.0f, 0.0f, 0.0f, 0.0f);
+    vec4f y_terms = combined * vec4f(0.0f, 1.0f, 0.0f, 0.0f);
+    return screen_transform{x_terms.x, y_terms.y, x_terms.w, y_terms.w};
+}
+
+visible_rect camera_2d::visible() const noexcept {
+    float half_width = width * 0.5f / zoom;
+    float half_height = height * 0.5f / zoom;
+    return visible_rect{centre.x - half_width, centre.y - half_height, centre.x + half_width, centre.y + half_height};
+}
+
+void camera_2d::clamp() noexcept {
+    float half_width = width * 0.5f / zoom;
+    float half_height = height * 0.5f / zoom;
+    centre.x = std::clamp(centre.x, half_width, width - half_width);
+    centre.y = std::clamp(centre.y, half_height, height - half_height);
+}
@@ -0,0 +1,71 @@
+#ifndef camera_hpp
+#define camera_hpp
+
+// std
+#include <algorithm>
+
+// my
+#include "djc_math/djc_math.hpp"
+
+/* a 2d camera over the simulation area - pan and zoom for the render passes.
+
+ the camera looks at centre (simulation pixels) from zoom times closer than the whole
+ area, never further out than the whole area and never past its edges. transform()
+ builds simulation -> screen from the djc_math helpers: a view matrix (zoom, flip y,
+ move centre to the origin), create_mat4_orthographic_matrix onto -1 .. 1 and
+ create_mat4_screenspace_transform onto the pixels. those two are laid out for row
+ vectors (translation in the last row), so the view is too and the three are chained
+ left to right. the result is only ever a scale and an offset per axis, which is all
+ the per point work is - the matrices are built once a frame, not once a point.
+
+ visible() is the part of the simulation area on screen, for culling before anything
+ is transformed.
+*/
+
+struct screen_transform {
+    float scale_x;
+    float scale_y;
+    float offset_x;
+    float offset_y;
+
+    djc::math::vec2f apply(djc::math::vec2f const & point) const noexcept {
+        return djc::math::vec2f(point.x * scale_x + offset_x, point.y * scale_y + offset_y);
+    }
+};
+
+struct visible_rect {
+    float min_x;
+    float min_y;
+    float max_x;
+    float max_y;
+
+    // cheap reject for a segment, true when its bounding box touches the rect
+    bool overlaps(float x1, float y1, float x2, float y2) const noexcept {
+        return std::max(x1, x2) >= min_x && std::min(x1, x2) <= max_x
+            && std::max(y1, y2) >= min_y && std::min(y1, y2) <= max_y;
+    }
+};
+
+struct camera_2d {
+    static constexpr float max_zoom = 32.0f;
+
+    int width;  // viewport and simulation area, in pixels
+    int height;
+    djc::math::vec2f centre;
+    float zoom;
+
+    camera_2d(int width, int height) noexcept;
+
+    void pan(float screen_dx, float screen_dy) noexcept;
+    void zoom_at(float factor, float screen_x, float screen_y) noexcept; // the point under screen_x, y stays put
+    void reset() noexcept;
+
+    bool is_identity() const noexcept;
+    screen_transform transform() const noexcept;
+    visible_rect visible() const noexcept;
+
+private:
+    void clamp() noexcept;
+};
+
+#endif // camera_hpp
@@ -0,0 +1,164 @@
+#include "chunked_field.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// my
+#include "simulation.hpp"
+
+namespace {
+
+constexpr std::size_t chunk_cell_count = chunked_field::chunk_cells * chunked_field::chunk_cells;
+constexpr std::size_t chunk_bytes = chunk_cell_count * (sizeof(djc::math::vec2f) + sizeof(std::uint8_t));
+
+//------------------------------------------------------------
+// rounds towards minus infinity, the world goes negative
+std::int64_t
+chunk_of(std::int64_t cell) noexcept {
+    return cell >= 0 ? cell / chunked_field::chunk_cells : -((-cell + chunked_field::chunk_cells - 1) / chunked_field::chunk_cells);
+}
+
+//------------------------------------------------------------
+std::uint64_t
+chunk_key(std::int64_t x, std::int64_t y) noexcept {
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+}
+
+} // namespace
+
+std::size_t chunked_field::key_hash::operator () (std::uint64_t key) const noexcept {
+    // neighbouring chunks differ in a few low bits of each half, spread them over the word
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+    return static_cast<std::size_t>(key ^ (key >> 31));
+}
+
+chunked_field::chunked_field(djc::math::perlin<double> const & noise, int screen_grid_width, int screen_grid_height, std::size_t max_bytes) noexcept(false)
+:   m_noise{noise}
+,   m_screen_grid_width{screen_grid_width}
+,   m_screen_grid_height{screen_grid_height}
+,   m_max_chunks{std::max<std::size_t>(1, max_bytes / chunk_bytes)}
+,   m_chunks{}
+,   m_index{}
+,   m_window{}
+,   m_stale{}
+,   m_chunks_generated{0} {
+
+    m_index.reserve(m_max_chunks);
+}
+
+void chunked_field::fill_window(std::int64_t x, std::int64_t y, int width, int height, double zstep,
+                                djc::math::vec2f *field, std::uint8_t *shades, thread_pool *workers) {
+    std::int64_t first_x = chunk_of(x);
+    std::int64_t last_x = chunk_of(x + width - 1);
+    std::int64_t first_y = chunk_of(y);
+    std::int64_t last_y = chunk_of(y + height - 1);
+
+    std::size_t columns = static_cast<std::size_t>(last_x - first_x + 1);
+    std::size_t needed = columns * static_cast<std::size_t>(last_y - first_y + 1);
+
+    m_window.clear();
+    m_stale.clear();
+
+    for (std::int64_t chunk_y = first_y; chunk_y <= last_y; chunk_y++) {
+        for (std::int64_t chunk_x = first_x; chunk_x <= last_x; chunk_x++) {
+            chunk & c = find_or_take(chunk_x, chunk_y, needed);
+            m_window.push_back(&c);
+
+            if (!c.generated || c.zstep != zstep) {
+                m_stale.push_back(&c);
+            }
+        }
+    }
+
+    auto generate_chunk = [this, zstep](std::size_t i) {
+        generate(*m_stale[i], zstep);
+    };
+
+    if (workers) {
+        workers->parallel_for(m_stale.size(), generate_chunk, "field chunks");
+    } else {
+        for (std::size_t i = 0; i < m_stale.size(); i++) generate_chunk(i);
+    }
+
+    m_chunks_generated += m_stale.size();
+
+    // copy the window out a row of one chunk at a time
+    for (int row = 0; row < height; row++) {
+        std::int64_t cell_y = y + row;
+        std::int64_t chunk_y = chunk_of(cell_y);
+        std::size_t local_y = static_cast<std::size_t>(cell_y - chunk_y * chunk_cells);
+
+        for (int column = 0; column < width;) {
+            std::int64_t cell_x = x + column;
+            std::int64_t chunk_x = chunk_of(cell_x);
+            std::size_t local_x = static_cast<std::size_t>(cell_x - chunk_x * chunk_cells);
+            std::size_t count = std::min<std::size_t>(chunk_cells - local_x, static_cast<std::size_t>(width - column));
+            chunk const & c = *m_window[static_cast<std::size_t>(chunk_y - first_y) * columns + static_cast<std::size_t>(chunk_x - first_x)];
+            std::size_t from = local_y * chunk_cells + local_x;
+            std::size_t to = static_cast<std::size_t>(row) * width + column;
+
+            std::copy_n(c.flow_field.data() + from, count, field + to);
+            std::memcpy(shades + to, c.shades.data() + from, count);
+            column += static_cast<int>(count);
+        }
+    }
+}
+
+std::size_t chunked_field::chunk_count() const noexcept {
+    return m_chunks.size();
+}
+
+std::size_t chunked_field::max_chunks() const noexcept {
+    return m_max_chunks;
+}
+
+std::uint64_t chunked_field::chunks_generated() const noexcept {
+    return m_chunks_generated;
+}
+
+chunked_field::chunk & chunked_field::find_or_take(std::int64_t x, std::int64_t y, std::size_t needed) {
+    std::uint64_t key = chunk_key(x, y);
+    auto found = m_index.find(key);
+
+    if (found != m_index.end()) {
+        m_chunks.splice(m_chunks.begin(), m_chunks, found->second);
+        return m_chunks.front();
+    }
+
+    if (m_chunks.size() < std::max(m_max_chunks, needed)) {
+        m_chunks.push_front(chunk{x, y, 0.0, false,
+                                  std::vector<djc::math::vec2f>(chunk_cell_count),
+                                  std::vector<std::uint8_t>(chunk_cell_count)});
+    } else {
+        // every chunk of this window so far is at the front, so the back is not one of them
+        m_index.erase(chunk_key(m_chunks.back().x, m_chunks.back().y));
+        m_chunks.splice(m_chunks.begin(), m_chunks, std::prev(m_chunks.end()));
+        m_chunks.front().x = x;
+        m_chunks.front().y = y;
+        m_chunks.front().generated = false;
+    }
+
+    m_index.emplace(key, m_chunks.begin());
+    return m_chunks.front();
+}
+
+void chunked_field::generate(chunk & target, double zstep) const {
+    // the same noise and scale as simulation::fill_flow_field, in world cells
+    for (int local_y = 0; local_y < chunk_cells; local_y++) {
+        for (int local_x = 0; local_x < chunk_cells; local_x++) {
+            double X = (double)(target.x * chunk_cells + local_x) / (double)m_screen_grid_width;
+            double Y = (double)(target.y * chunk_cells + local_y) / (double)m_screen_grid_height;
+
+            float angle = m_noise.noise(X * 5, Y * 5, zstep);
+            std::size_t index = static_cast<std::size_t>(local_y) * chunk_cells + local_x;
+            target.shades[index] = static_cast<std::uint8_t>(angle * 255);
+            target.flow_field[index] = djc::math::vec2f(std::cos(angle * djc::math::tau<float>), std::sin(angle * djc::math::tau<float>)) * simulation::flow_strength;
+        }
+    }
+
+    target.zstep = zstep;
+    target.generated = true;
+}
@@ -0,0 +1,85 @@
+#ifndef chunked_field_hpp
+#define chunked_field_hpp
+
+// std
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// my
+#include "djc_math/djc_math.hpp"
+#include "thread_pool.hpp"
+
+/* an unbounded flow field, generated a chunk at a time around wherever the camera is.
+
+ the world is cut into chunk_cells x chunk_cells cell chunks keyed by their integer
+ chunk coordinates. fill_window() copies the cells of a screen sized window out of the
+ chunks into an ordinary flow field, so everything downstream of the field is the same
+ as for the one screen field. a window at 0, 0 is exactly the field the simulation fills
+ without a world.
+
+ only chunks that a window touches are ever generated, and only when they were not
+ generated for this zstep yet. the field moves through zstep every step, so in practice
+ that is every chunk of the window every step - the same cells the screen field fills,
+ plus the part of the edge chunks the window does not reach. they are generated
+ together in one parallel_for over the thread pool.
+
+ chunks live in an lru of at most max_bytes. it saves the allocations rather than the
+ noise: when it is full the chunk used longest ago is taken over, buffers and all, for
+ the next chunk that is needed, so after the cap is reached nothing is allocated and
+ memory stays the same however far the camera goes. a window always gets every chunk
+ it needs, even past the cap.
+
+ chunk_cells is 16 rather than something bigger because the default window is only
+ 21 x 15 cells - bigger chunks would generate mostly cells that are never seen. the
+ noise repeats every 256 units, 51 screen widths at the default scale.
+*/
+
+struct chunked_field {
+    static constexpr int chunk_cells = 16;
+
+    // screen_grid_width / height set the noise scale so a window matches the screen field
+    chunked_field(djc::math::perlin<double> const & noise, int screen_grid_width, int screen_grid_height, std::size_t max_bytes) noexcept(false);
+
+    chunked_field(chunked_field const &) = delete;
+    chunked_field & operator = (chunked_field const &) = delete;
+
+    // x, y are the window origin in cells
+    void fill_window(std::int64_t x, std::int64_t y, int width, int height, double zstep,
+                     djc::math::vec2f *field, std::uint8_t *shades, thread_pool *workers = nullptr);
+
+    std::size_t chunk_count() const noexcept;
+    std::size_t max_chunks() const noexcept;
+    std::uint64_t chunks_generated() const noexcept; // since construction
+
+private:
+    struct chunk {
+        std::int64_t x; // chunk coordinates
+        std::int64_t y;
+        double zstep;
+        bool generated;
+        std::vector<djc::math::vec2f> flow_field;
+        std::vector<std::uint8_t> shades;
+    };
+
+    struct key_hash {
+        std::size_t operator () (std::uint64_t key) const noexcept;
+    };
+
+    chunk & find_or_take(std::int64_t x, std::int64_t y, std::size_t needed);
+    void generate(chunk & target, double zstep) const;
+
+    djc::math::perlin<double> const & m_noise;
+    int m_screen_grid_width;
+    int m_screen_grid_height;
+    std::size_t m_max_chunks;
+    std::list<chunk> m_chunks; // most recently used first
+    std::unordered_map<std::uint64_t, std::list<chunk>::iterator, key_hash> m_index;
+    std::vector<chunk *> m_window;  // chunks of the last fill_window, row by row
+    std::vector<chunk *> m_stale;
+    std::uint64_t m_chunks_generated;
+};
+
+#endif // chunked_field_hpp
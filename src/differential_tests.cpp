@@ -0,0 +1,761 @@
+// std
+#include <algorithm>
+#include <cstdarg>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// my
+#include "djc_math/djc_math.hpp"
+#include "simulation.hpp"
+#include "ghost_rasterizer.hpp"
+#include "thread_pool.hpp"
+#include "emitter.hpp"
+#include "field_sequence.hpp"
+#include "snapshot.hpp"
+#include "trajectory.hpp"
+#include "chunked_field.hpp"
+
+/* differential tests - every fast path is checked against its scalar reference.
+
+ each check feeds the same inputs (random plus the edge cases: negative coordinates,
+ lattice boundaries, the 255 permutation wrap, large magnitudes) to the kernel under
+ test and its reference, and records the largest absolute error and the largest
+ error in ulps. a check fails when either goes over its stated bound. bounds of 0
+ mean the paths have to be bit identical.
+
+ round trips (files written and read back, state carried over) have nothing to measure
+ an error on - they make pass / fail expectations with expect() instead, and fail when
+ any of them does. the first failure is reported with its own message.
+
+ new fast paths get a check here before they are switched on.
+
+ usage: differential_tests [--seed <n>] [--samples <n>]
+*/
+
+namespace {
+
+struct check_result {
+    std::string name;
+    std::size_t samples;
+    double max_abs_error;
+    double max_ulp_error;
+    double abs_bound;
+    double ulp_bound;
+    std::string worst_input;
+    double worst_score;
+    std::size_t expectations = 0;
+    std::size_t failed_expectations = 0;
+    std::string first_failure;
+
+    bool passed() const {
+        return max_abs_error <= abs_bound && max_ulp_error <= ulp_bound && failed_expectations == 0;
+    }
+};
+
+struct test_config {
+    unsigned int seed = 20240611;
+    std::size_t samples = 200000;
+};
+
+//------------------------------------------------------------
+double
+ulp_distance(float value, float reference) {
+    if (std::isnan(value) || std::isnan(reference)) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    // map the float bit patterns onto a monotonic integer line
+    auto ordered = [](float f) {
+        std::int32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits < 0 ? std::int64_t(std::numeric_limits<std::int32_t>::min()) - bits : std::int64_t(bits);
+    };
+
+    return static_cast<double>(std::llabs(ordered(value) - ordered(reference)));
+}
+
+//------------------------------------------------------------
+void
+record(check_result & result, double value, double reference, float value_f, float reference_f, char const *input_format, double a, double b, double c) {
+    double abs_error = std::abs(value - reference);
+    double ulp_error = ulp_distance(value_f, reference_f);
+
+    if (std::isnan(value) != std::isnan(reference)) {
+        abs_error = std::numeric_limits<double>::infinity();
+    }
+
+    // how far over (or towards) its bounds this sample is, to remember the worst input
+    double score = abs_error / std::max(result.abs_bound, 1.0e-300) + ulp_error / std::max(result.ulp_bound, 1.0);
+
+    if (score > result.worst_score) {
+        result.worst_score = score;
+        char buffer[160];
+        std::snprintf(buffer, sizeof(buffer), input_format, a, b, c);
+        result.worst_input = buffer;
+    }
+
+    result.max_abs_error = std::max(result.max_abs_error, abs_error);
+    result.max_ulp_error = std::max(result.max_ulp_error, ulp_error);
+    result.samples++;
+}
+
+//------------------------------------------------------------
+// a pass / fail expectation, the message is printf formatted and only built on failure
+void
+expect(check_result & result, bool ok, char const *format, ...) {
+    result.expectations++;
+
+    if (ok) {
+        return;
+    }
+
+    if (result.failed_expectations++ == 0) {
+        char buffer[256];
+        std::va_list args;
+        va_start(args, format);
+        std::vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        result.first_failure = buffer;
+    }
+}
+
+//------------------------------------------------------------
+// the points every noise check is run on
+// the fast paths are all float, so every input is a float and reaches the double
+// reference exactly
+std::vector<djc::math::vec3<float>>
+noise_inputs(test_config const & config) {
+    std::vector<djc::math::vec3<float>> points;
+    std::mt19937 rng(config.seed);
+
+    // random, around the origin and across the whole 256 period including negatives
+    std::uniform_real_distribution<float> near(-8.0f, 8.0f);
+    std::uniform_real_distribution<float> period(-600.0f, 600.0f);
+    
+    for (std::size_t i = 0; i < config.samples / 2; i++) {
+        points.emplace_back(near(rng), near(rng), near(rng));
+        points.emplace_back(period(rng), period(rng), period(rng));
+    }
+
+    // lattice boundaries - on, just below and just above integer coordinates
+    float const lattice[] = {-257.0f, -256.0f, -255.0f, -1.0f, 0.0f, 1.0f, 254.0f, 255.0f, 256.0f, 257.0f, 511.0f, 512.0f};
+    
+    for (float l : lattice) {
+        for (float offset : {0.0f, -1.0e-5f, 1.0e-5f, -0.5f, 0.5f}) {
+            float v = l + offset;
+            points.emplace_back(v, 0.25f, 0.75f);
+            points.emplace_back(0.25f, v, 0.75f);
+            points.emplace_back(0.25f, 0.75f, v);
+            points.emplace_back(v, v, v);
+        }
+    }
+
+    // large magnitudes, still inside the int range that noise() floors into
+    std::uniform_real_distribution<float> large(-1.0e6f, 1.0e6f);
+    
+    for (std::size_t i = 0; i < config.samples / 10; i++) {
+        points.emplace_back(large(rng), large(rng), large(rng));
+    }
+
+    return points;
+}
+
+//                         checks                           //
+//------------------------------------------------------------
+check_result
+check_float_noise(test_config const & config) {
+    check_result result{"perlin<float>::noise vs perlin<double>::noise", 0, 0.0, 0.0, 2.0e-6, 64.0, "", 0.0};
+    djc::math::perlin<double> reference(227);
+    djc::math::perlin<float> fast(227);
+
+    for (djc::math::vec3<float> const & p : noise_inputs(config)) {
+        double expected = reference.noise(p.x, p.y, p.z);
+        float value = fast.noise(p.x, p.y, p.z);
+        record(result, value, expected, value, float(expected), "(%.9g, %.9g, %.9g)", p.x, p.y, p.z);
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------
+// not a fast path, but the invariants every fast path inherits from the reference
+check_result
+check_noise_invariants(test_config const & config) {
+    check_result result{"perlin<double>::noise invariants (range, lattice, 256 wrap)", 0, 0.0, 0.0, 0.0, 0.0, "", 0.0};
+    djc::math::perlin<double> noisy(227);
+
+    for (djc::math::vec3<float> const & p : noise_inputs(config)) {
+        double value = noisy.noise(p.x, p.y, p.z);
+
+        // range is [0, 1]
+        double out_of_range = value < 0.0 ? -value : value > 1.0 ? value - 1.0 : 0.0;
+        record(result, out_of_range, 0.0, float(out_of_range), 0.0f, "range (%.9g, %.9g, %.9g)", p.x, p.y, p.z);
+
+        // the permutation wraps every 256 units, exactly (p + 256 is exact for these magnitudes)
+        if (std::abs(p.x) < 1.0e5) {
+            double wrapped = noisy.noise(p.x + 256.0, p.y, p.z - 512.0);
+            record(result, wrapped, value, float(wrapped), float(value), "wrap (%.9g, %.9g, %.9g)", p.x, p.y, p.z);
+        }
+
+        // on the lattice every gradient is dotted with a zero vector, so noise is exactly 0.5
+        double lattice_value = noisy.noise(std::floor(p.x), std::floor(p.y), std::floor(p.z));
+        record(result, lattice_value, 0.5, float(lattice_value), 0.5f, "lattice (%.9g, %.9g, %.9g)", std::floor(p.x), std::floor(p.y), std::floor(p.z));
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------
+check_result
+check_flow_field(test_config const &) {
+    check_result result{"simulation::update_flow_field vs scalar reference", 0, 0.0, 0.0, 0.0, 0.0, "", 0.0};
+    simulation sim(640, 460, 30, 0);
+    djc::math::perlin<double> reference(227);
+    std::vector<std::uint32_t> pixels(static_cast<std::size_t>(sim.grid_width) * sim.grid_height);
+
+    for (int frame = 0; frame < 50; frame++) {
+        sim.update_flow_field(pixels.data(), sim.grid_width * static_cast<int>(sizeof(std::uint32_t)));
+
+        for (int y = 0; y < sim.grid_height; y++) {
+            for (int x = 0; x < sim.grid_width; x++) {
+                int index = y * sim.grid_width + x;
+                float angle = reference.noise((double)x / sim.grid_width * 5, (double)y / sim.grid_height * 5, sim.zstep);
+                std::uint8_t noise = angle * 255;
+                djc::math::vec2f expected(std::cos(angle * djc::math::tau<float>) * 20.0f, std::sin(angle * djc::math::tau<float>) * 20.0f);
+                std::uint32_t expected_pixel = (255u << 24) + (noise << 16) + (noise << 8) + noise;
+
+                record(result, sim.flow_field[index].x, expected.x, sim.flow_field[index].x, expected.x, "cell x (%g, %g) z %g", x, y, sim.zstep);
+                record(result, sim.flow_field[index].y, expected.y, sim.flow_field[index].y, expected.y, "cell y (%g, %g) z %g", x, y, sim.zstep);
+                record(result, pixels[index], expected_pixel, 0.0f, 0.0f, "pixel (%g, %g) z %g", x, y, sim.zstep);
+            }
+        }
+
+        sim.step();
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------
+check_result
+check_particle_update(test_config const & config) {
+    check_result result{"simulation::update_particles vs scalar reference", 0, 0.0, 0.0, 0.0, 0.0, "", 0.0};
+    simulation sim(640, 460, 30, 4096, config.seed);
+    
+    // edge cases - on, just inside and just outside every screen edge
+    float const xs[] = {-0.5f, 0.0f, 0.5f, 319.5f, 639.5f, 640.0f, 640.5f};
+    float const ys[] = {-0.5f, 0.0f, 0.5f, 229.5f, 459.5f, 460.0f, 460.5f};
+    std::size_t i = 0;
+
+    for (float x : xs) {
+        for (float y : ys) {
+            sim.particles[i++].current_position = djc::math::vec2f(x, y);
+        }
+    }
+
+    std::vector<particle> reference = sim.particles;
+
+    for (int frame = 0; frame < 100; frame++) {
+        sim.update_flow_field(nullptr, 0);
+        sim.update_particles();
+
+        // the scalar reference integrator, written out longhand
+        for (particle & p : reference) {
+            if (p.current_position.x < 0) p.current_position.x = sim.width;
+            if (p.current_position.x > sim.width) p.current_position.x = 0;
+            if (p.current_position.y < 0) p.current_position.y = sim.height;
+            if (p.current_position.y > sim.height) p.current_position.y = 0;
+
+            int grid_x = std::clamp(static_cast<int>(std::floor(p.current_position.x / sim.grid_divisor)), 0, sim.grid_width - 1);
+            int grid_y = std::clamp(static_cast<int>(std::floor(p.current_position.y / sim.grid_divisor)), 0, sim.grid_height - 1);
+
+            p.last_position = p.current_position;
+            p.acceleration += sim.flow_field[grid_y * sim.grid_width + grid_x] * 0.01f;
+            p.velocity += p.acceleration;
+            p.velocity = djc::math::limit(p.velocity, 4.0f);
+            p.current_position += p.velocity;
+            p.acceleration *= 0.0f;
+        }
+
+        for (std::size_t n = 0; n < reference.size(); n++) {
+            particle const & p = sim.particles[n];
+            particle const & r = reference[n];
+            record(result, p.current_position.x, r.current_position.x, p.current_position.x, r.current_position.x, "particle %g frame %g axis x%g", n, frame, 0);
+            record(result, p.current_position.y, r.current_position.y, p.current_position.y, r.current_position.y, "particle %g frame %g axis y%g", n, frame, 0);
+            record(result, p.velocity.x, r.velocity.x, p.velocity.x, r.velocity.x, "particle %g frame %g velocity x%g", n, frame, 0);
+            record(result, p.velocity.y, r.velocity.y, p.velocity.y, r.velocity.y, "particle %g frame %g velocity y%g", n, frame, 0);
+        }
+
+        sim.step();
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------
+check_result
+check_ghost_rasterizer(test_config const & config) {
+    check_result result{"ghost_rasterizer 4 threads vs 1 thread", 0, 0.0, 0.0, 0.0, 0.0, "", 0.0};
+    thread_pool serial(0);
+    thread_pool parallel(3);
+    ghost_rasterizer serial_ghost(640, 460, 64);
+    ghost_rasterizer parallel_ghost(640, 460, 64);
+    std::mt19937 rng(config.seed);
+    std::uniform_real_distribution<float> position(-20.0f, 660.0f);
+    std::uniform_real_distribution<float> step(-6.0f, 6.0f);
+
+    for (int frame = 0; frame < 20; frame++) {
+        serial_ghost.begin(0, 0, 0, 10);
+        parallel_ghost.begin(0, 0, 0, 10);
+
+        for (int i = 0; i < 20000; i++) {
+            float x = position(rng);
+            float y = position(rng);
+            float dx = step(rng);
+            float dy = step(rng);
+
+            // every few segments cross a 64 pixel tile edge on purpose
+            if (i % 7 == 0) {
+                x = std::floor(x / 64.0f) * 64.0f - 0.5f;
+            }
+
+            serial_ghost.push(x, y, x + dx, y + dy);
+            parallel_ghost.push(x, y, x + dx, y + dy);
+        }
+
+        serial_ghost.rasterize(serial);
+        parallel_ghost.rasterize(parallel);
+    }
+
+    for (std::size_t i = 0; i < serial_ghost.pixels.size(); i++) {
+        double differs = serial_ghost.pixels[i] != parallel_ghost.pixels[i] ? 1.0 : 0.0;
+        record(result, differs, 0.0, 0.0f, 0.0f, "pixel %g (%g, %g)", i, i % 640, i / 640);
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------
+// a small weight buffer with black pixels, the faintest and the brightest grey level
+std::vector<std::uint8_t>
+emitter_weights(int width, int height) {
+    std::vector<std::uint8_t> weights(static_cast<std::size_t>(width) * height);
+
+    for (std::size_t i = 0; i < weights.size(); i++) {
+        weights[i] = i % 4 == 3 ? 0 : static_cast<std::uint8_t>((i * 37) % 256);
+    }
+
+    weights[1] = 1;
+    weights[2] = 255;
+    return weights;
+}
+
+//------------------------------------------------------------
+// the alias table has to pick every pixel in proportion to its weight
+check_result
+check_alias_frequencies(test_config const & config) {
+    check_result result{"particle_emitter alias table vs pixel weights", 0, 0.0, 0.0, 1.0e-3, 0.0, "", 0.0};
+    int const width = 13;
+    int const height = 7;
+    std::size_t const draws = 4000000;
+    std::vector<std::uint8_t> weights = emitter_weights(width, height);
+    particle_emitter emitter(width, height);
+
+    if (emitter.load_weights(weights.data(), width, height) < 0) {
+        expect(result, false, "load_weights refused a %d x %d weight buffer", width, height);
+        return result;
+    }
+
+    std::vector<std::size_t> picked(weights.size(), 0);
+    spawn_rng rng(config.seed, 0);
+
+    for (std::size_t i = 0; i < draws; i++) {
+        std::uint32_t pick = rng.next();
+        picked[emitter.pick_pixel(pick, rng.next())]++;
+    }
+
+    double total = 0.0;
+
+    for (std::uint8_t weight : weights) {
+        total += weight;
+    }
+
+    for (std::size_t i = 0; i < weights.size(); i++) {
+        double frequency = static_cast<double>(picked[i]) / draws;
+        record(result, frequency, weights[i] / total, 0.0f, 0.0f, "pixel %g weight %g picked %g", i, weights[i], picked[i]);
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------
+// a black pixel can never be picked, and every position lands inside the area
+check_result
+check_alias_zero_weights(test_config const & config) {
+    check_result result{"particle_emitter never picks a zero weight", 0, 0.0, 0.0, 0.0, 0.0, "", 0.0};
+    int const width = 13;
+    int const height = 7;
+    std::vector<std::uint8_t> weights = emitter_weights(width, height);
+    particle_emitter emitter(width * 10, height * 10);
+
+    if (emitter.load_weights(weights.data(), width, height) < 0) {
+        expect(result, false, "load_weights refused a %d x %d weight buffer", width, height);
+        return result;
+    }
+
+    // random pairs, then the edges of the threshold range
+    spawn_rng rng(config.seed, 1);
+
+    for (std::size_t i = 0; i < config.samples * 10; i++) {
+        std::uint32_t pick = rng.next();
+        std::uint32_t keep = rng.next();
+        std::uint32_t pixel = emitter.pick_pixel(pick, keep);
+        expect(result, weights[pixel] != 0, "pick %u keep %u picked the black pixel %u", pick, keep, pixel);
+    }
+
+    for (std::uint64_t pixel = 0; pixel < weights.size(); pixel++) {
+        // the first and last pick that lands on this pixel
+        std::uint32_t first = static_cast<std::uint32_t>(((pixel << 32) + weights.size() - 1) / weights.size());
+        std::uint32_t last = static_cast<std::uint32_t>((((pixel + 1) << 32) - 1) / weights.size());
+
+        for (std::uint32_t pick : {first, last}) {
+            for (std::uint32_t keep : {0u, 1u, 0x7fffffffu, 0xfffffffeu, 0xffffffffu}) {
+                std::uint32_t picked = emitter.pick_pixel(pick, keep);
+                expect(result, weights[picked] != 0, "pick %u keep %u picked the black pixel %u", pick, keep, picked);
+            }
+        }
+    }
+
+    std::vector<djc::math::vec2f> positions(config.samples);
+    emitter.emit(rng, positions.size(), positions.data());
+
+    for (djc::math::vec2f const & p : positions) {
+        bool outside = p.x < 0.0f || p.x > emitter.width || p.y < 0.0f || p.y > emitter.height;
+        expect(result, !outside, "position (%g, %g) is outside %d x %d", p.x, p.y, emitter.width, emitter.height);
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------
+// a bake played back has to step the simulation to the same state as the noise it was
+// baked from, and a bake with a step missing must not play at all
+check_result
+check_field_playback(test_config const & config) {
+    check_result result{"field_sequence playback vs the baked simulation", 0, 0.0, 0.0, 0.0, 0.0, "", 0.0};
+    char const *path = "differential_tests_fields.tmp";
+    char const *gap_path = "differential_tests_gap.tmp";
+    simulation baked(320, 200, 10, 2000, config.seed);
+    simulation played(320, 200, 10, 2000, config.seed);
+    field_sequence_writer writer;
+    field_sequence_writer gap_writer;
+
+    if (writer.open(path, "vec2f", baked.grid_width, baked.grid_height) < 0 || gap_writer.open(gap_path, "vec2f", baked.grid_width, baked.grid_height) < 0) {
+        expect(result, false, "could not write the bakes");
+        return result;
+    }
+
+    std::vector<std::uint64_t> baked_hashes;
+
+    // the bake starts part way in, so playback has to go by the baked steps
+    for (int frame = 0; frame < 5; frame++) {
+        baked.tick();
+        played.tick();
+    }
+
+    for (int frame = 0; frame < 60; frame++) {
+        baked.tick();
+        baked_hashes.push_back(baked.state_hash());
+        writer.append(baked.flow_field.data(), baked.shades.data(), baked.steps - 1);
+
+        if (frame != 30) {
+            gap_writer.append(baked.flow_field.data(), baked.shades.data(), baked.steps - 1);
+        }
+    }
+
+    writer.close();
+    gap_writer.close();
+
+    field_sequence_reader reader;
+    field_sequence_reader gap_reader;
+
+    if (reader.open(path) < 0) {
+        expect(result, false, "could not read the bake back");
+    } else {
+        played.playback = &reader;
+
+        for (int frame = 0; frame < 60; frame++) {
+            played.tick();
+            expect(result, played.state_hash() == baked_hashes[frame], "state differs at baked step %llu", static_cast<unsigned long long>(played.steps - 1));
+        }
+    }
+
+    // logs the refusal, which is the point
+    expect(result, gap_reader.open(gap_path) < 0, "a bake missing a step was opened for playback");
+
+    std::remove(path);
+    std::remove(gap_path);
+    return result;
+}
+
+//------------------------------------------------------------
+// a restored simulation has to carry on exactly like the one that was saved, and a
+// header whose particle count wraps the layout round must not load
+check_result
+check_snapshot_round_trip(test_config const & config) {
+    check_result result{"load_snapshot vs the saved simulation", 0, 0.0, 0.0, 0.0, 0.0, "", 0.0};
+    char const *path = "differential_tests_snapshot.tmp";
+    thread_pool workers(3);
+    simulation saved(320, 200, 10, 5000, config.seed);
+    simulation restored(320, 200, 20, 100, config.seed + 1);
+
+    saved.lifetime = 30;
+    restored.lifetime = 30;
+    saved.camera_x = -7;
+    saved.camera_y = 12;
+
+    for (int frame = 0; frame < 40; frame++) {
+        saved.tick(&workers);
+    }
+
+    if (save_snapshot(saved, path, &workers) < 0 || load_snapshot(restored, path, &workers) < 0) {
+        expect(result, false, "could not save and load \"%s\"", path);
+        std::remove(path);
+        return result;
+    }
+
+    expect(result, restored.camera_x == saved.camera_x && restored.camera_y == saved.camera_y, "camera restored at (%lld, %lld), saved at (%lld, %lld)",
+           static_cast<long long>(restored.camera_x), static_cast<long long>(restored.camera_y),
+           static_cast<long long>(saved.camera_x), static_cast<long long>(saved.camera_y));
+
+    for (int frame = 0; frame < 40; frame++) {
+        expect(result, restored.state_hash() == saved.state_hash(), "state differs %d steps after loading", frame);
+        saved.tick(&workers);
+        restored.tick(&workers);
+    }
+
+    // particle_count follows the 48 byte front of the header - plus 2^62 particles of 4
+    // bytes each lays every section out exactly where it was
+    std::FILE *file = std::fopen(path, "r+b");
+    bool written = false;
+
+    if (file) {
+        std::uint64_t count = 0;
+        std::fseek(file, 48, SEEK_SET);
+        bool read = std::fread(&count, sizeof(count), 1, file) == 1;
+        count += std::uint64_t(1) << 62;
+        std::fseek(file, 48, SEEK_SET);
+        written = read && std::fwrite(&count, sizeof(count), 1, file) == 1;
+        std::fclose(file);
+    }
+
+    simulation crafted(320, 200, 10, 100, config.seed);
+    expect(result, written, "could not craft the particle count of \"%s\"", path);
+    expect(result, !written || load_snapshot(crafted, path) < 0, "a particle count that wraps the layout round was loaded");
+
+    std::remove(path);
+    return result;
+}
+
+//------------------------------------------------------------
+// records a running simulation, reads it back and compares every frame with the positions
+// it was given. the recorder is flushed after every frame, so none are dropped
+void
+trajectory_round_trip(check_result & result, char const *encoding, unsigned int seed) {
+    char const *path = "differential_tests_trajectory.tmp";
+    int const width = 640;
+    int const height = 460;
+    std::size_t const stride = 3;
+    simulation sim(width, height, 20, 3000, seed);
+    trajectory_recorder recorder;
+    std::vector<std::vector<djc::math::vec2f>> given;
+
+    if (recorder.open(path, encoding, width, height, sim.particles.size(), 1, static_cast<int>(stride)) < 0) {
+        expect(result, false, "could not record \"%s\"", path);
+        return;
+    }
+
+    for (int frame = 0; frame < 30; frame++) {
+        sim.tick();
+        given.emplace_back();
+
+        for (std::size_t i = 0; i < sim.particles.size(); i += stride) {
+            given.back().push_back(sim.particles[i].current_position);
+        }
+
+        recorder.record(sim.view());
+        recorder.flush();
+    }
+
+    recorder.close();
+
+    trajectory_reader reader;
+
+    if (reader.open(path) < 0 || reader.particle_count() != given[0].size()) {
+        expect(result, false, "could not read \"%s\" back", path);
+        std::remove(path);
+        return;
+    }
+
+    expect(result, reader.frame_count() == given.size(), "%llu frames read back, %zu recorded",
+           static_cast<unsigned long long>(reader.frame_count()), given.size());
+
+    // int16 clamps to the area
+    bool clamped = std::strcmp(encoding, "int16") == 0;
+    std::vector<float> xs(reader.particle_count());
+    std::vector<float> ys(reader.particle_count());
+
+    for (std::uint64_t frame = 0; frame < reader.frame_count(); frame++) {
+        std::uint64_t step = 0;
+
+        bool read = reader.read_frame(frame, step, xs.data(), ys.data()) == 0;
+        expect(result, read && step == frame + 1, "frame %llu read back as step %llu", static_cast<unsigned long long>(frame), static_cast<unsigned long long>(step));
+
+        if (!read || step == 0 || step > given.size()) {
+            continue;
+        }
+
+        std::vector<djc::math::vec2f> const & positions = given[step - 1];
+
+        for (std::size_t i = 0; i < positions.size(); i++) {
+            float x = clamped ? std::clamp(positions[i].x, 0.0f, float(width)) : positions[i].x;
+            float y = clamped ? std::clamp(positions[i].y, 0.0f, float(height)) : positions[i].y;
+            // ulps only mean something for the float encoding
+            float ulps = clamped ? 0.0f : 1.0f;
+            record(result, xs[i], x, xs[i] * ulps, x * ulps, "step %g particle %g x %g", step, i, x);
+            record(result, ys[i], y, ys[i] * ulps, y * ulps, "step %g particle %g y %g", step, i, y);
+        }
+    }
+
+    std::remove(path);
+}
+
+//------------------------------------------------------------
+check_result
+check_trajectory_float(test_config const & config) {
+    check_result result{"trajectory_reader float vs the recorded positions", 0, 0.0, 0.0, 0.0, 0.0, "", 0.0};
+    trajectory_round_trip(result, "float", config.seed);
+    return result;
+}
+
+//------------------------------------------------------------
+// within half a quantisation step of the 640 pixel wide side (plus float rounding)
+check_result
+check_trajectory_int16(test_config const & config) {
+    check_result result{"trajectory_reader int16 vs the recorded positions", 0, 0.0, 0.0, 0.5 * 640.0 / 65535.0 + 1.0e-4, 0.0, "", 0.0};
+    trajectory_round_trip(result, "int16", config.seed);
+    return result;
+}
+
+//------------------------------------------------------------
+// a world window at 0, 0 has to be the screen field bit for bit, and once the camera
+// stops no more chunks are generated than the window itself needs
+check_result
+check_world_window(test_config const & config) {
+    check_result result{"chunked_field window at 0, 0 vs the screen field", 0, 0.0, 0.0, 0.0, 0.0, "", 0.0};
+    simulation screen(640, 460, 20, 2000, config.seed);
+    simulation windowed(640, 460, 20, 2000, config.seed);
+    chunked_field world(windowed.noisy, windowed.grid_width, windowed.grid_height, 8 << 20);
+    windowed.world = &world;
+
+    std::uint64_t still_chunks = 0;
+
+    for (int frame = 0; frame < 40; frame++) {
+        std::uint64_t generated = world.chunks_generated();
+        screen.tick();
+        windowed.tick();
+
+        bool same_shades = std::memcmp(screen.shades.data(), windowed.shades.data(), screen.shades.size()) == 0;
+        expect(result, screen.state_hash() == windowed.state_hash() && same_shades, "the window differs from the screen field at step %d", frame);
+
+        if (frame == 1) {
+            still_chunks = world.chunks_generated() - generated;
+        }
+    }
+
+    // one step there and one back, then standing still again
+    windowed.pan(1, 1);
+    windowed.tick();
+    windowed.pan(-1, -1);
+    windowed.tick();
+
+    for (int frame = 0; frame < 5; frame++) {
+        std::uint64_t generated = world.chunks_generated();
+        windowed.tick();
+        std::uint64_t chunks = world.chunks_generated() - generated;
+        expect(result, chunks == still_chunks, "%llu chunks generated standing still %d steps after a pan, %llu before it",
+               static_cast<unsigned long long>(chunks), frame, static_cast<unsigned long long>(still_chunks));
+    }
+
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    test_config config;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            config.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            config.samples = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "usage: %s [--seed <n>] [--samples <n>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    check_result (*const checks[])(test_config const &) = {
+        check_noise_invariants,
+        check_float_noise,
+        check_flow_field,
+        check_particle_update,
+        check_ghost_rasterizer,
+        check_alias_frequencies,
+        check_alias_zero_weights,
+        check_field_playback,
+        check_snapshot_round_trip,
+        check_trajectory_float,
+        check_trajectory_int16,
+        check_world_window,
+    };
+
+    int failures = 0;
+
+    std::printf("seed %u, %zu samples\n\n", config.seed, config.samples);
+
+    for (auto check : checks) {
+        check_result result = check(config);
+        failures += !result.passed();
+
+        std::printf("[%s] %s\n", result.passed() ? " OK " : "FAIL", result.name.c_str());
+
+        if (result.samples > 0) {
+            std::printf("       samples %zu, max abs error %.3g (bound %.3g), max ulp error %.0f (bound %.0f)\n",
+                result.samples, result.max_abs_error, result.abs_bound, result.max_ulp_error, result.ulp_bound);
+        }
+
+        if (!result.worst_input.empty() && (result.max_abs_error > 0.0 || result.max_ulp_error > 0.0)) {
+            std::printf("       worst at %s\n", result.worst_input.c_str());
+        }
+
+        if (result.expectations > 0) {
+            std::printf("       expectations %zu, %zu failed\n", result.expectations, result.failed_expectations);
+        }
+
+        if (!result.first_failure.empty()) {
+            std::printf("       first failure: %s\n", result.first_failure.c_str());
+        }
+    }
+
+    std::printf("\n%d of %zu checks failed\n", failures, sizeof(checks) / sizeof(checks[0]));
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,418 @@
+#include "djc_math.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace djc::math;
+
+/* micro benchmarks for djc_math
+
+ every benchmark is warmed up, then the iteration count is scaled until one
+ repetition takes about 20ms, then it is repeated and the median ns/op is reported.
+ results go to stdout and, with --json <path>, to a json file that can be diffed
+ against a baseline.
+
+ usage: djc_math_bench [--filter <substring>] [--repetitions <n>] [--json <path>]
+*/
+
+//                       harness                            //
+//------------------------------------------------------------
+template<typename T>
+inline void
+do_not_optimize(T const & value) {
+    // tells the compiler value is read, so the work producing it can not be dropped
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+//------------------------------------------------------------
+template<typename T>
+inline void
+clobber_value(T & value) {
+    // tells the compiler value may have changed, so work on it can not be hoisted out of a loop
+    asm volatile("" : "+m,r"(value) : : "memory");
+}
+
+//------------------------------------------------------------
+inline void
+clobber_memory() {
+    asm volatile("" : : : "memory");
+}
+
+struct bench_result {
+    std::string name;
+    std::size_t iterations;
+    double ns_per_op_median;
+    double ns_per_op_min;
+    double ns_per_op_stddev;
+    double ops_per_second;
+};
+
+struct bench_config {
+    char const *filter = nullptr;
+    char const *json_path = nullptr;
+    int repetitions = 10;
+    std::chrono::nanoseconds warm_up = std::chrono::milliseconds(50);
+    std::chrono::nanoseconds min_repetition = std::chrono::milliseconds(20);
+};
+
+//------------------------------------------------------------
+// body(iterations) runs the measured work iterations times, ops_per_iteration says how many
+// operations one iteration is (e.g. grid cells) so ns/op is comparable between sizes
+std::vector<bench_result> g_results;
+bench_config g_config;
+
+void
+run_benchmark(char const *name, std::size_t ops_per_iteration, std::function<void(std::size_t)> const & body) {
+    using clock = std::chrono::steady_clock;
+
+    if (g_config.filter && std::strstr(name, g_config.filter) == nullptr) {
+        return;
+    }
+
+    auto time = [&](std::size_t iterations) {
+        auto start = clock::now();
+        body(iterations);
+        clobber_memory();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+    };
+
+    // warm up caches, branch predictors and the cpu clock
+    auto warm_start = clock::now();
+    while (clock::now() - warm_start < g_config.warm_up) {
+        time(64);
+    }
+
+    // grow the iteration count until one repetition is long enough to time reliably
+    std::size_t iterations = 1;
+    while (true) {
+        auto elapsed = time(iterations);
+        
+        if (elapsed >= g_config.min_repetition || iterations >= (std::size_t(1) << 40)) {
+            break;
+        }
+
+        double scale = elapsed.count() > 0 ? 1.2 * g_config.min_repetition.count() / elapsed.count() : 10.0;
+        iterations = static_cast<std::size_t>(iterations * std::clamp(scale, 2.0, 10.0));
+    }
+
+    std::vector<double> ns_per_op;
+    
+    for (int r = 0; r < g_config.repetitions; r++) {
+        ns_per_op.push_back(static_cast<double>(time(iterations).count()) / (iterations * ops_per_iteration));
+    }
+
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+    
+    double mean = 0.0;
+    for (double v : ns_per_op) mean += v;
+    mean /= ns_per_op.size();
+    
+    double variance = 0.0;
+    for (double v : ns_per_op) variance += (v - mean) * (v - mean);
+    variance /= ns_per_op.size();
+
+    bench_result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.ns_per_op_median = ns_per_op[ns_per_op.size() / 2];
+    result.ns_per_op_min = ns_per_op.front();
+    result.ns_per_op_stddev = std::sqrt(variance);
+    result.ops_per_second = result.ns_per_op_median > 0.0 ? 1.0e9 / result.ns_per_op_median : 0.0;
+
+    std::printf("%-40s %12.3f ns/op %12.3f min %8.3f sd %14.0f ops/s\n",
+        name, result.ns_per_op_median, result.ns_per_op_min, result.ns_per_op_stddev, result.ops_per_second);
+    std::fflush(stdout);
+
+    g_results.push_back(result);
+}
+
+//------------------------------------------------------------
+int
+write_json(char const *path) {
+    std::FILE *file = std::fopen(path, "wb");
+
+    if (file == nullptr) {
+        std::fprintf(stderr, "could not open \"%s\"\n", path);
+        return -1;
+    }
+
+    std::fprintf(file, "{\n  \"suite\": \"djc_math\",\n  \"repetitions\": %d,\n  \"benchmarks\": [\n", g_config.repetitions);
+
+    for (std::size_t i = 0; i < g_results.size(); i++) {
+        bench_result const & r = g_results[i];
+        std::fprintf(file, "    {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.4f, \"ns_per_op_min\": %.4f, \"ns_per_op_stddev\": %.4f, \"ops_per_second\": %.1f}%s\n",
+            r.name.c_str(), r.iterations, r.ns_per_op_median, r.ns_per_op_min, r.ns_per_op_stddev, r.ops_per_second, i + 1 < g_results.size() ? "," : "");
+    }
+
+    std::fputs("  ]\n}\n", file);
+    return std::fclose(file) == 0 ? 0 : -1;
+}
+
+//                      benchmarks                          //
+//------------------------------------------------------------
+template<typename T>
+void
+noise_benchmarks(char const *scalar_name, char const *batch_name, char const *grid_name) {
+    perlin<T> noisy(227);
+
+    // scalar - the input moves every call so nothing can be hoisted out of the loop
+    run_benchmark(scalar_name, 1, [&](std::size_t iterations) {
+        T z = T(0.5);
+        for (std::size_t i = 0; i < iterations; i++) {
+            do_not_optimize(noisy.noise(T(0.37) + z, T(1.91) - z, z));
+            z += T(0.001);
+        }
+    });
+
+    // batch - a buffer of scattered points, including negative coordinates
+    std::vector<T> xs(1024), ys(1024), zs(1024), out(1024);
+    for (std::size_t i = 0; i < xs.size(); i++) {
+        xs[i] = T(std::sin(i * 0.7) * 40.0);
+        ys[i] = T(std::cos(i * 1.3) * 40.0);
+        zs[i] = T(i * 0.01);
+    }
+
+    run_benchmark(batch_name, xs.size(), [&](std::size_t iterations) {
+        for (std::size_t n = 0; n < iterations; n++) {
+            for (std::size_t i = 0; i < xs.size(); i++) {
+                out[i] = noisy.noise(xs[i], ys[i], zs[i]);
+            }
+            do_not_optimize(out.data());
+        }
+    });
+
+    // grid - the same access pattern as the flow field fill
+    int const width = 128;
+    int const height = 128;
+
+    run_benchmark(grid_name, width * height, [&](std::size_t iterations) {
+        T z = T(0);
+        for (std::size_t n = 0; n < iterations; n++) {
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    do_not_optimize(noisy.noise(T(x) / width * 5, T(y) / height * 5, z));
+                }
+            }
+            z += T(0.005);
+        }
+    });
+}
+
+//------------------------------------------------------------
+void
+vec_benchmarks() {
+    vec2f a2(3.0f, 4.0f);
+    vec2f b2(0.1f, -0.2f);
+    
+    run_benchmark("vec2f/add_mul", 1, [&](std::size_t iterations) {
+        vec2f acc(0.0f);
+        for (std::size_t i = 0; i < iterations; i++) {
+            clobber_value(a2);
+            clobber_value(b2);
+            acc += a2 * 0.01f + b2;
+            do_not_optimize(acc);
+        }
+    });
+
+    run_benchmark("vec2f/limit", 1, [&](std::size_t iterations) {
+        vec2f v = a2;
+        for (std::size_t i = 0; i < iterations; i++) {
+            v = limit(v + b2, 4.0f);
+            do_not_optimize(v);
+        }
+    });
+
+    run_benchmark("vec2f/normalise", 1, [&](std::size_t iterations) {
+        vec2f v = a2;
+        for (std::size_t i = 0; i < iterations; i++) {
+            v = normalise(v + b2);
+            do_not_optimize(v);
+        }
+    });
+
+    vec3f a3(1.0f, 2.0f, 3.0f);
+    vec3f b3(-0.5f, 0.25f, 0.125f);
+
+    run_benchmark("vec3f/normalise", 1, [&](std::size_t iterations) {
+        vec3f v = a3;
+        for (std::size_t i = 0; i < iterations; i++) {
+            v = normalise(v + b3);
+            do_not_optimize(v);
+        }
+    });
+
+    run_benchmark("vec3f/cross", 1, [&](std::size_t iterations) {
+        vec3f v = a3;
+        for (std::size_t i = 0; i < iterations; i++) {
+            v = v.cross(b3) + a3;
+            do_not_optimize(v);
+        }
+    });
+
+    run_benchmark("vec3f/dot", 1, [&](std::size_t iterations) {
+        float acc = 0.0f;
+        for (std::size_t i = 0; i < iterations; i++) {
+            clobber_value(a3);
+            clobber_value(b3);
+            acc += dot(a3, b3);
+            do_not_optimize(acc);
+        }
+    });
+
+    vec4f a4(1.0f, 2.0f, 3.0f, 4.0f);
+    vec4f b4(0.5f, -0.5f, 0.25f, -0.25f);
+
+    run_benchmark("vec4f/normalise", 1, [&](std::size_t iterations) {
+        vec4f v = a4;
+        for (std::size_t i = 0; i < iterations; i++) {
+            v = normalise(v + b4);
+            do_not_optimize(v);
+        }
+    });
+
+    run_benchmark("vec4f/dot", 1, [&](std::size_t iterations) {
+        float acc = 0.0f;
+        for (std::size_t i = 0; i < iterations; i++) {
+            clobber_value(a4);
+            clobber_value(b4);
+            acc += dot(a4, b4);
+            do_not_optimize(acc);
+        }
+    });
+}
+
+//------------------------------------------------------------
+void
+matrix_benchmarks() {
+    mat3f m3 = create_mat3_rotation_matrix(vec3f(0.1f, 0.2f, 0.3f));
+    mat4f m4 = create_mat4_model_matrix(vec3f(1.0f, 2.0f, 3.0f), vec3f(0.1f, 0.2f, 0.3f), vec3f(1.0f));
+
+    run_benchmark("mat3f/mul_mat3", 1, [&](std::size_t iterations) {
+        mat3f acc = create_mat3_identity_matrix<float>();
+        for (std::size_t i = 0; i < iterations; i++) {
+            acc = acc * m3;
+            do_not_optimize(acc);
+        }
+    });
+
+    run_benchmark("mat3f/mul_vec3", 1, [&](std::size_t iterations) {
+        vec3f v(1.0f, 0.0f, 0.0f);
+        for (std::size_t i = 0; i < iterations; i++) {
+            v = m3 * v;
+            do_not_optimize(v);
+        }
+    });
+
+    run_benchmark("mat4f/mul_mat4", 1, [&](std::size_t iterations) {
+        mat4f acc = create_mat4_identity_matrix<float>();
+        for (std::size_t i = 0; i < iterations; i++) {
+            acc = acc * m4;
+            do_not_optimize(acc);
+        }
+    });
+
+    run_benchmark("mat4f/mul_vec4", 1, [&](std::size_t iterations) {
+        vec4f v(1.0f, 0.0f, 0.0f, 1.0f);
+        for (std::size_t i = 0; i < iterations; i++) {
+            v = m4 * v;
+            do_not_optimize(v);
+        }
+    });
+}
+
+//------------------------------------------------------------
+void
+transform_benchmarks() {
+    float t = 0.0f;
+
+    run_benchmark("transform/rotation_mat4", 1, [&](std::size_t iterations) {
+        for (std::size_t i = 0; i < iterations; i++) {
+            do_not_optimize(create_mat4_rotation_matrix(vec3f(t, t * 0.5f, t * 0.25f)));
+            t += 0.001f;
+        }
+    });
+
+    run_benchmark("transform/model_mat4", 1, [&](std::size_t iterations) {
+        for (std::size_t i = 0; i < iterations; i++) {
+            do_not_optimize(create_mat4_model_matrix(vec3f(t), vec3f(t, 0.0f, 0.0f), vec3f(1.0f)));
+            t += 0.001f;
+        }
+    });
+
+    run_benchmark("transform/projection_mat4", 1, [&](std::size_t iterations) {
+        for (std::size_t i = 0; i < iterations; i++) {
+            do_not_optimize(create_mat4_projection_matrix(1.2f + t, 16.0f / 9.0f, 0.01f, 1000.0f));
+            t += 0.000001f;
+        }
+    });
+
+    run_benchmark("transform/orthographic_mat4", 1, [&](std::size_t iterations) {
+        int width = 640;
+        for (std::size_t i = 0; i < iterations; i++) {
+            do_not_optimize(create_mat4_orthographic_matrix(width, 460, 0.01f, 1000.0f));
+            width ^= 1;
+        }
+    });
+
+    run_benchmark("transform/view_mat4", 1, [&](std::size_t iterations) {
+        for (std::size_t i = 0; i < iterations; i++) {
+            do_not_optimize(create_mat4_view_matrix(vec3f(t, 1.0f, 5.0f), vec3f(0.0f), vec3f(0.0f, 1.0f, 0.0f)));
+            t += 0.001f;
+        }
+    });
+
+    run_benchmark("transform/screenspace_mat4", 1, [&](std::size_t iterations) {
+        float half_width = 320.0f;
+        for (std::size_t i = 0; i < iterations; i++) {
+            do_not_optimize(create_mat4_screenspace_transform(half_width, 230.0f));
+            half_width += 1.0f;
+        }
+    });
+
+    run_benchmark("transform/transform_vec4", 1, [&](std::size_t iterations) {
+        mat4f m = create_mat4_translation_matrix(vec3f(0.001f));
+        vec4f v(1.0f, 1.0f, 1.0f, 1.0f);
+        for (std::size_t i = 0; i < iterations; i++) {
+            transform(v, m);
+            do_not_optimize(v);
+        }
+    });
+}
+
+//------------------------------------------------------------
+int
+main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            g_config.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            g_config.repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            g_config.json_path = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: %s [--filter <substring>] [--repetitions <n>] [--json <path>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    noise_benchmarks<double>("perlin<double>/noise_scalar", "perlin<double>/noise_batch", "perlin<double>/noise_grid");
+    noise_benchmarks<float>("perlin<float>/noise_scalar", "perlin<float>/noise_batch", "perlin<float>/noise_grid");
+    vec_benchmarks();
+    matrix_benchmarks();
+    transform_benchmarks();
+
+    if (g_config.json_path && write_json(g_config.json_path) < 0) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
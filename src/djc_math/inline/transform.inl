@@ -176,8 +176,6 @@ create_mat4_projection_matrix(T fov, T aspect, T near, T far) noexcept {
     T sZ { -(far + near) / (far - near)};
     T sA {static_cast<T>(-1)};
     T sB { -(static_cast<T>(2) * far * near) / (far - near)};
-    
-    T zero {static_cast<T>(0)};
 
     return mat4<T>(std::array<T, 16>{{
          sX,    0,     0,     0,
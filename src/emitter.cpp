@@ -0,0 +1,287 @@
+#include "emitter.hpp"
+
+// std
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+// dependancies
+#include "SDL2/SDL.h"
+
+namespace {
+
+constexpr std::uint64_t golden_gamma = 0x9e3779b97f4a7c15ull;
+constexpr std::size_t emit_batch = 256; // positions per fill() of the random numbers
+
+//------------------------------------------------------------
+std::uint64_t
+mix(std::uint64_t z) noexcept {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+//------------------------------------------------------------
+// the top 24 bits as a float in [0, 1)
+float
+to_unit(std::uint32_t value) noexcept {
+    return static_cast<float>(value >> 8) * (1.0f / 16777216.0f);
+}
+
+//------------------------------------------------------------
+// the next number of a pgm header, skipping white space and # comments
+bool
+read_header_number(std::FILE *file, int & value) noexcept {
+    int c = std::fgetc(file);
+
+    for (;;) {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) c = std::fgetc(file);
+        } else if (std::isspace(c)) {
+            c = std::fgetc(file);
+        } else {
+            break;
+        }
+    }
+
+    if (!std::isdigit(c)) {
+        return false;
+    }
+
+    value = 0;
+
+    while (std::isdigit(c)) {
+        value = value * 10 + (c - '0');
+
+        if (value > 1 << 20) {
+            return false;
+        }
+
+        c = std::fgetc(file);
+    }
+
+    // exactly one white space character ends the header
+    return std::isspace(c);
+}
+
+} // namespace
+
+spawn_rng::spawn_rng(std::uint64_t seed, std::uint64_t stream) noexcept
+:   state{mix(seed ^ mix(stream + golden_gamma))} {
+
+}
+
+std::uint32_t spawn_rng::next() noexcept {
+    return static_cast<std::uint32_t>(mix(state += golden_gamma) >> 32);
+}
+
+float spawn_rng::unit() noexcept {
+    return to_unit(next());
+}
+
+void spawn_rng::fill(std::uint32_t *values, std::size_t count) noexcept {
+    std::uint64_t base = state;
+
+    for (std::size_t i = 0; i < count; i++) {
+        values[i] = static_cast<std::uint32_t>(mix(base + (i + 1) * golden_gamma) >> 32);
+    }
+
+    state = base + count * golden_gamma;
+}
+
+particle_emitter::particle_emitter(int width, int height) noexcept
+:   kind{emitter_kind::uniform}
+,   width{width}
+,   height{height}
+,   m_image_width{0}
+,   m_image_height{0}
+,   m_table{} {
+
+}
+
+int particle_emitter::set_kind(char const *kind_name) noexcept {
+    if (std::strcmp(kind_name, "uniform") == 0) {
+        kind = emitter_kind::uniform;
+    } else if (std::strcmp(kind_name, "edges") == 0) {
+        kind = emitter_kind::edges;
+    } else if (std::strcmp(kind_name, "image") == 0) {
+        if (m_table.empty()) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "the image emitter needs an image (--emit-image)");
+            return -1;
+        }
+
+        kind = emitter_kind::image;
+    } else {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "unknown emitter \"%s\" (uniform, edges or image)", kind_name);
+        return -1;
+    }
+
+    return 0;
+}
+
+int particle_emitter::load_image(char const *path) noexcept(false) {
+    std::FILE *file = std::fopen(path, "rb");
+
+    if (!file) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open emitter image \"%s\": %s", path, std::strerror(errno));
+        return -1;
+    }
+
+    char magic[2] = {};
+    int image_width = 0;
+    int image_height = 0;
+    int max_value = 0;
+    char const *error = nullptr;
+    std::vector<std::uint8_t> pixels;
+
+    if (std::fread(magic, 1, 2, file) != 2 || magic[0] != 'P' || magic[1] != '5') {
+        error = "not a binary pgm (P5)";
+    } else if (!read_header_number(file, image_width) || !read_header_number(file, image_height) || !read_header_number(file, max_value)
+               || image_width <= 0 || image_height <= 0 || max_value <= 0) {
+        error = "corrupt header";
+    } else if (max_value > 255) {
+        error = "16 bit pgm is not supported";
+    } else if (static_cast<std::uint64_t>(image_width) * static_cast<std::uint64_t>(image_height) > max_image_pixels) {
+        error = "too large";
+    } else {
+        pixels.resize(static_cast<std::size_t>(image_width) * image_height);
+
+        if (std::fread(pixels.data(), 1, pixels.size(), file) != pixels.size()) {
+            error = "truncated";
+        }
+    }
+
+    std::fclose(file);
+
+    if (error) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not load emitter image \"%s\": %s", path, error);
+        return -1;
+    }
+
+    if (load_weights(pixels.data(), image_width, image_height) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not use emitter image \"%s\"", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int particle_emitter::load_weights(std::uint8_t const *weights, int weights_width, int weights_height) noexcept(false) {
+    if (weights_width <= 0 || weights_height <= 0
+        || static_cast<std::uint64_t>(weights_width) * static_cast<std::uint64_t>(weights_height) > max_image_pixels) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "emitter weights of %d x %d are not usable", weights_width, weights_height);
+        return -1;
+    }
+
+    std::size_t count = static_cast<std::size_t>(weights_width) * weights_height;
+    std::uint64_t total = 0;
+
+    for (std::size_t i = 0; i < count; i++) {
+        total += weights[i];
+    }
+
+    if (total == 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "the emitter weights are black everywhere, nothing could be born");
+        return -1;
+    }
+
+    // vose - scaled so the mean pixel is 1, every pixel under 1 is topped up from one over 1
+    std::vector<double> scaled(count);
+    std::vector<std::uint32_t> small;
+    std::vector<std::uint32_t> large;
+    std::vector<alias_entry> table(count);
+
+    for (std::size_t i = 0; i < count; i++) {
+        scaled[i] = static_cast<double>(weights[i]) * static_cast<double>(count) / static_cast<double>(total);
+        table[i] = alias_entry{std::numeric_limits<std::uint32_t>::max(), static_cast<std::uint32_t>(i)};
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<std::uint32_t>(i));
+    }
+
+    while (!small.empty() && !large.empty()) {
+        std::uint32_t under = small.back();
+        std::uint32_t over = large.back();
+        small.pop_back();
+
+        table[under] = alias_entry{static_cast<std::uint32_t>(std::min(scaled[under] * 4294967296.0, 4294967295.0)), over};
+        scaled[over] -= 1.0 - scaled[under];
+
+        if (scaled[over] < 1.0) {
+            large.pop_back();
+            small.push_back(over);
+        }
+    }
+
+    // whatever is left is 1 give or take rounding, it keeps itself
+    m_image_width = weights_width;
+    m_image_height = weights_height;
+    m_table = std::move(table);
+    kind = emitter_kind::image;
+    return 0;
+}
+
+void particle_emitter::emit(spawn_rng & rng, std::size_t count, djc::math::vec2f *positions) const noexcept {
+    float w = static_cast<float>(width);
+    float h = static_cast<float>(height);
+    std::uint32_t random[emit_batch * 4];
+
+    for (std::size_t done = 0; done < count; done += emit_batch) {
+        std::size_t batch = std::min(emit_batch, count - done);
+        djc::math::vec2f *out = positions + done;
+
+        switch (kind) {
+            case emitter_kind::uniform:
+                rng.fill(random, batch * 2);
+
+                for (std::size_t i = 0; i < batch; i++) {
+                    out[i] = djc::math::vec2f(to_unit(random[i * 2]) * w, to_unit(random[i * 2 + 1]) * h);
+                }
+                break;
+
+            case emitter_kind::edges:
+                rng.fill(random, batch);
+
+                // walk round the border clockwise from the top left corner
+                for (std::size_t i = 0; i < batch; i++) {
+                    float along = to_unit(random[i]) * (w + h) * 2.0f;
+
+                    if (along < w) {
+                        out[i] = djc::math::vec2f(along, 0.0f);
+                    } else if (along < w + h) {
+                        out[i] = djc::math::vec2f(w, along - w);
+                    } else if (along < w * 2.0f + h) {
+                        out[i] = djc::math::vec2f(w * 2.0f + h - along, h);
+                    } else {
+                        out[i] = djc::math::vec2f(0.0f, w * 2.0f + h * 2.0f - along);
+                    }
+                }
+                break;
+
+            case emitter_kind::image: {
+                // a pixel, its own or its alias by the threshold, then anywhere inside it
+                std::uint32_t image_width = static_cast<std::uint32_t>(m_image_width);
+                float pixel_width = w / static_cast<float>(m_image_width);
+                float pixel_height = h / static_cast<float>(m_image_height);
+                rng.fill(random, batch * 4);
+
+                for (std::size_t i = 0; i < batch; i++) {
+                    std::uint32_t const *r = random + i * 4;
+                    std::uint32_t pixel = pick_pixel(r[0], r[1]);
+                    float x = (static_cast<float>(pixel % image_width) + to_unit(r[2])) * pixel_width;
+                    float y = (static_cast<float>(pixel / image_width) + to_unit(r[3])) * pixel_height;
+                    out[i] = djc::math::vec2f(x, y);
+                }
+                break;
+            }
+        }
+    }
+}
+
+std::uint32_t particle_emitter::pick_pixel(std::uint32_t pick, std::uint32_t keep) const noexcept {
+    std::uint32_t pixel = static_cast<std::uint32_t>((static_cast<std::uint64_t>(pick) * m_table.size()) >> 32);
+    alias_entry const & entry = m_table[pixel];
+    return keep < entry.threshold ? pixel : entry.alias;
+}
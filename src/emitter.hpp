@@ -0,0 +1,82 @@
+#ifndef emitter_hpp
+#define emitter_hpp
+
+// std
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// my
+#include "djc_math/djc_math.hpp"
+
+/* where particles are born when they respawn (see simulation::lifetime).
+
+    uniform     anywhere in the area
+    edges       anywhere on its border, every pixel of the border as likely
+    image       weighted by the grey level of an image stretched over the area - black
+                never, white the most. load_image() reads a binary pgm (P5),
+                load_weights() takes a raw buffer of 8 bit weights (a mask or a logo
+                drawn some other way)
+
+ the image is turned into a walker / vose alias table once, when it is loaded: every
+ pixel gets a threshold and an alias, so a sample is one random pixel and one random
+ threshold - keep the pixel under it, take its alias over it. a spawn costs the same
+ whatever the size of the image, no search and no branch.
+
+ emit() writes count positions from an rng the caller owns, so every thread of a
+ parallel update can emit into its own buffer with its own stream and nothing is shared.
+ it draws its random numbers a batch at a time with spawn_rng::fill() and then turns
+ the batch into positions, two loops simple enough for the compiler to vectorise.
+*/
+
+/* splitmix64 on one word of state, seeded from a seed and a stream number so the
+ stream of a chunk of particles is the same whichever thread runs it. the state only
+ counts up, so fill() computes a batch of outputs independently of each other - the
+ same numbers as that many next() calls.
+*/
+
+struct spawn_rng {
+    std::uint64_t state;
+
+    spawn_rng(std::uint64_t seed, std::uint64_t stream) noexcept;
+
+    std::uint32_t next() noexcept;
+    float unit() noexcept; // [0, 1)
+    void fill(std::uint32_t *values, std::size_t count) noexcept;
+};
+
+enum class emitter_kind {
+    uniform,
+    edges,
+    image
+};
+
+struct particle_emitter {
+    static constexpr std::uint64_t max_image_pixels = std::uint64_t(1) << 28; // 256 mb of grey levels
+
+    emitter_kind kind;
+    int width;  // the area particles are born in
+    int height;
+
+    particle_emitter(int width, int height) noexcept;
+
+    // kind_name is "uniform", "edges" or "image" (which needs load_image() as well)
+    int set_kind(char const *kind_name) noexcept;
+    int load_image(char const *path) noexcept(false);
+    int load_weights(std::uint8_t const *weights, int weights_width, int weights_height) noexcept(false);
+
+    void emit(spawn_rng & rng, std::size_t count, djc::math::vec2f *positions) const noexcept;
+    std::uint32_t pick_pixel(std::uint32_t pick, std::uint32_t keep) const noexcept; // one alias table sample from two random numbers
+
+private:
+    int m_image_width;
+    int m_image_height;
+    struct alias_entry {
+        std::uint32_t threshold; // keep the pixel below this 32 bit threshold
+        std::uint32_t alias;     // the pixel taken above it
+    };
+
+    std::vector<alias_entry> m_table; // per pixel, side by side so a sample touches one cache line
+};
+
+#endif // emitter_hpp
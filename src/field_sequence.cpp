@@ -0,0 +1,378 @@
+#include "field_sequence.hpp"
+
+// std
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+// posix
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// dependancies
+#include "SDL2/SDL.h"
+
+namespace {
+
+constexpr char field_magic[8] = {'P', 'F', 'F', 'F', 'I', 'E', 'L', 'D'};
+constexpr std::uint32_t field_version = 1;
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+struct field_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t encoding;
+    std::int32_t grid_width;
+    std::int32_t grid_height;
+    std::uint32_t reserved;
+    std::uint64_t frame_size;
+    std::uint64_t reserved_2[3];
+};
+
+static_assert(sizeof(field_header) == 64, "the frames start at byte 64");
+
+//------------------------------------------------------------
+// the step, the field and the shades, padded so the next step is 8 byte aligned
+std::uint64_t
+frame_size(field_encoding encoding, std::size_t cells) noexcept {
+    std::size_t field = encoding == field_encoding::angle16 ? cells * sizeof(std::uint16_t) : cells * 2 * sizeof(float);
+    return (sizeof(std::uint64_t) + field + cells + 7) & ~std::uint64_t(7);
+}
+
+//------------------------------------------------------------
+bool
+write_all(int fd, std::uint8_t const *data, std::size_t size) noexcept {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------
+// madvise wants a page aligned start
+void
+will_need(unsigned char const *mapping, std::size_t begin, std::size_t end) noexcept {
+    static std::size_t const page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t aligned = begin & ~(page - 1);
+    madvise(const_cast<unsigned char *>(mapping) + aligned, end - aligned, MADV_WILLNEED);
+}
+
+} // namespace
+
+field_sequence_writer::field_sequence_writer() noexcept
+:   m_encoding{field_encoding::vec2f}
+,   m_fd{-1}
+,   m_cell_count{0}
+,   m_frames_written{0}
+,   m_frame{} {
+
+}
+
+field_sequence_writer::~field_sequence_writer() {
+    close();
+}
+
+int field_sequence_writer::open(char const *path, char const *encoding_name, int grid_width, int grid_height) noexcept(false) {
+    if (is_open()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "the field bake is already open");
+        return -1;
+    }
+
+    if (!encoding_name || std::strcmp(encoding_name, "vec2f") == 0) {
+        m_encoding = field_encoding::vec2f;
+    } else if (std::strcmp(encoding_name, "angle16") == 0) {
+        m_encoding = field_encoding::angle16;
+    } else {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "unknown field format \"%s\" (vec2f or angle16)", encoding_name);
+        return -1;
+    }
+
+    m_cell_count = static_cast<std::size_t>(grid_width) * grid_height;
+
+    field_header header{};
+    std::memcpy(header.magic, field_magic, sizeof(header.magic));
+    header.version = field_version;
+    header.byte_order = byte_order_mark;
+    header.encoding = static_cast<std::uint32_t>(m_encoding);
+    header.grid_width = grid_width;
+    header.grid_height = grid_height;
+    header.frame_size = frame_size(m_encoding, m_cell_count);
+
+    m_fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (m_fd < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open field bake \"%s\": %s", path, std::strerror(errno));
+        return -1;
+    }
+
+    if (!write_all(m_fd, reinterpret_cast<std::uint8_t const *>(&header), sizeof(header))) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not write to field bake \"%s\": %s", path, std::strerror(errno));
+        ::close(m_fd);
+        m_fd = -1;
+        return -1;
+    }
+
+    m_frame.assign(header.frame_size, 0);
+    m_frames_written = 0;
+    return 0;
+}
+
+int field_sequence_writer::append(djc::math::vec2f const *field, std::uint8_t const *shades, std::uint64_t step) noexcept {
+    if (!is_open()) {
+        return -1;
+    }
+
+    std::uint8_t *out = m_frame.data();
+    std::memcpy(out, &step, sizeof(step));
+    out += sizeof(step);
+
+    if (m_encoding == field_encoding::vec2f) {
+        float *xs = reinterpret_cast<float *>(out);
+        float *ys = xs + m_cell_count;
+
+        for (std::size_t i = 0; i < m_cell_count; i++) {
+            xs[i] = field[i].x;
+            ys[i] = field[i].y;
+        }
+
+        out += m_cell_count * 2 * sizeof(float);
+    } else {
+        std::uint16_t *angles = reinterpret_cast<std::uint16_t *>(out);
+
+        for (std::size_t i = 0; i < m_cell_count; i++) {
+            float turn = std::atan2(field[i].y, field[i].x) / djc::math::tau<float>;
+            turn = turn < 0.0f ? turn + 1.0f : turn;
+            angles[i] = static_cast<std::uint16_t>(static_cast<std::uint32_t>(turn * 65536.0f + 0.5f) & 0xffff);
+        }
+
+        out += m_cell_count * sizeof(std::uint16_t);
+    }
+
+    std::memcpy(out, shades, m_cell_count);
+
+    if (!write_all(m_fd, m_frame.data(), m_frame.size())) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "field bake: writing frame %llu failed: %s",
+                     static_cast<unsigned long long>(m_frames_written), std::strerror(errno));
+        return -1;
+    }
+
+    m_frames_written++;
+    return 0;
+}
+
+void field_sequence_writer::close() noexcept {
+    if (!is_open()) {
+        return;
+    }
+
+    ::close(m_fd);
+    m_fd = -1;
+    m_frame.clear();
+    m_frame.shrink_to_fit();
+    SDL_Log("field bake: wrote %llu frames", static_cast<unsigned long long>(m_frames_written));
+}
+
+bool field_sequence_writer::is_open() const noexcept {
+    return m_fd >= 0;
+}
+
+std::uint64_t field_sequence_writer::frames_written() const noexcept {
+    return m_frames_written;
+}
+
+field_sequence_reader::field_sequence_reader() noexcept
+:   m_mapping{nullptr}
+,   m_mapping_size{0}
+,   m_encoding{field_encoding::vec2f}
+,   m_grid_width{0}
+,   m_grid_height{0}
+,   m_frame_size{0}
+,   m_frame_count{0}
+,   m_first_step{0} {
+
+}
+
+field_sequence_reader::~field_sequence_reader() {
+    close();
+}
+
+int field_sequence_reader::open(char const *path) noexcept {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+
+    if (fd < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open field sequence \"%s\": %s", path, std::strerror(errno));
+        return -1;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) < 0 || static_cast<std::size_t>(info.st_size) < sizeof(field_header)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "\"%s\" is too small to be a field sequence", path);
+        ::close(fd);
+        return -1;
+    }
+
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+
+    if (mapping == MAP_FAILED) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not map field sequence \"%s\": %s", path, std::strerror(errno));
+        return -1;
+    }
+
+    field_header header;
+    std::memcpy(&header, mapping, sizeof(header));
+    char const *error = nullptr;
+
+    if (std::memcmp(header.magic, field_magic, sizeof(header.magic)) != 0) {
+        error = "not a field sequence";
+    } else if (header.byte_order != byte_order_mark) {
+        error = "written on a machine with a different byte order";
+    } else if (header.version != field_version || header.encoding > static_cast<std::uint32_t>(field_encoding::angle16)) {
+        error = "unsupported field sequence version";
+    } else if (header.grid_width <= 0 || header.grid_height <= 0
+               || header.frame_size != frame_size(static_cast<field_encoding>(header.encoding),
+                                                  static_cast<std::size_t>(header.grid_width) * header.grid_height)) {
+        error = "corrupt header";
+    } else if ((size - sizeof(header)) / header.frame_size == 0) {
+        error = "no frames";
+    }
+
+    // every step has to be there, or the playback drifts out of step with the simulation
+    std::uint64_t frame_count = error ? 0 : (size - sizeof(header)) / header.frame_size; // a bake cut short ends at its last whole frame
+    std::uint64_t first_step = 0;
+
+    for (std::uint64_t frame = 0; frame < frame_count; frame++) {
+        std::uint64_t step;
+        std::memcpy(&step, static_cast<unsigned char const *>(mapping) + sizeof(header) + frame * header.frame_size, sizeof(step));
+
+        if (frame == 0) {
+            first_step = step;
+        } else if (step != first_step + frame) {
+            error = "steps are missing, bake headless or with --serial to get every step";
+            break;
+        }
+    }
+
+    if (error) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open field sequence \"%s\": %s", path, error);
+        munmap(mapping, size);
+        return -1;
+    }
+
+    m_mapping = static_cast<unsigned char const *>(mapping);
+    m_mapping_size = size;
+    m_encoding = static_cast<field_encoding>(header.encoding);
+    m_grid_width = header.grid_width;
+    m_grid_height = header.grid_height;
+    m_frame_size = header.frame_size;
+    m_frame_count = frame_count;
+    m_first_step = first_step;
+
+    // played front to back, pages behind the playback can go
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    return 0;
+}
+
+void field_sequence_reader::close() noexcept {
+    if (m_mapping) {
+        munmap(const_cast<unsigned char *>(m_mapping), m_mapping_size);
+    }
+
+    m_mapping = nullptr;
+    m_mapping_size = 0;
+    m_frame_count = 0;
+}
+
+int field_sequence_reader::read_frame(std::uint64_t frame, djc::math::vec2f *field, std::uint8_t *shades) noexcept {
+    if (!m_mapping) {
+        return -1;
+    }
+
+    frame %= m_frame_count;
+
+    // the frames after this one, and the start again when playback is about to wrap
+    std::size_t begin = sizeof(field_header) + (frame + 1) * m_frame_size;
+    std::uint64_t ahead = std::min(read_ahead_frames, m_frame_count - frame - 1);
+
+    if (ahead > 0) {
+        will_need(m_mapping, begin, begin + ahead * m_frame_size);
+    }
+
+    if (ahead < read_ahead_frames) {
+        will_need(m_mapping, 0, sizeof(field_header) + std::min(read_ahead_frames - ahead, m_frame_count) * m_frame_size);
+    }
+
+    std::size_t cells = static_cast<std::size_t>(m_grid_width) * m_grid_height;
+    unsigned char const *in = m_mapping + sizeof(field_header) + frame * m_frame_size + sizeof(std::uint64_t);
+
+    if (m_encoding == field_encoding::vec2f) {
+        float const *xs = reinterpret_cast<float const *>(in);
+        float const *ys = xs + cells;
+
+        for (std::size_t i = 0; i < cells; i++) {
+            field[i] = djc::math::vec2f(xs[i], ys[i]);
+        }
+
+        in += cells * 2 * sizeof(float);
+    } else {
+        std::uint16_t const *angles = reinterpret_cast<std::uint16_t const *>(in);
+
+        for (std::size_t i = 0; i < cells; i++) {
+            float turn = angles[i] * (djc::math::tau<float> / 65536.0f);
+            field[i] = djc::math::vec2f(std::cos(turn), std::sin(turn)) * simulation::flow_strength;
+        }
+
+        in += cells * sizeof(std::uint16_t);
+    }
+
+    std::memcpy(shades, in, cells);
+    return 0;
+}
+
+int field_sequence_reader::read_step(std::uint64_t step, djc::math::vec2f *field, std::uint8_t *shades) noexcept {
+    if (!m_mapping) {
+        return -1;
+    }
+
+    // steps before the first frame wrap backwards from the end
+    std::uint64_t frame = step >= m_first_step ? (step - m_first_step) % m_frame_count
+                                               : (m_frame_count - (m_first_step - step) % m_frame_count) % m_frame_count;
+    return read_frame(frame, field, shades);
+}
+
+std::uint64_t field_sequence_reader::frame_count() const noexcept {
+    return m_frame_count;
+}
+
+std::uint64_t field_sequence_reader::first_step() const noexcept {
+    return m_first_step;
+}
+
+field_encoding field_sequence_reader::encoding() const noexcept {
+    return m_encoding;
+}
+
+int field_sequence_reader::grid_width() const noexcept {
+    return m_grid_width;
+}
+
+int field_sequence_reader::grid_height() const noexcept {
+    return m_grid_height;
+}
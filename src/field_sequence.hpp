@@ -0,0 +1,103 @@
+#ifndef field_sequence_hpp
+#define field_sequence_hpp
+
+// std
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// my
+#include "djc_math/djc_math.hpp"
+#include "simulation.hpp"
+
+/* a baked sequence of flow fields, one per simulation step, so a machine that can not
+ afford the noise can play back fields that a faster one computed.
+
+ the file is append only - a 64 byte header, then one fixed size frame per step:
+
+    header          magic, version, byte order mark, encoding, grid width / height,
+                    frame size
+    frame           the step (8 bytes), the field, the shades (one byte per cell)
+
+ the field is either vec2f - every x then every y as floats - or angle16, the direction
+ of every cell as a 16 bit fraction of a turn (the length is always
+ simulation::flow_strength). angle16 is a third of the size for a direction error well
+ under a hundredth of a degree.
+
+ the writer is synchronous, a frame is a few tens of kilobytes. main.cpp appends after
+ every step, not every frame, and steps the simulation on the main thread while baking -
+ on its own thread only the steps that were drawn would be seen.
+
+ the reader maps the whole file with MADV_SEQUENTIAL and asks for the next few frames
+ ahead of the one being read with MADV_WILLNEED, so the kernel has them in memory before
+ they are needed and playback never waits on the disk. frames past the end wrap around.
+
+ playback is by step - read_step() reads the frame baked for that step, counted from the
+ step of the first frame. open() checks the steps of every frame follow on one from the
+ other and refuses a bake with gaps (one baked alongside the simulation thread), which
+ would otherwise play back out of step with the simulation.
+ open(), append(), read_frame() and read_step() return -1 after logging the reason.
+*/
+
+enum class field_encoding : std::uint32_t {
+    vec2f,
+    angle16
+};
+
+struct field_sequence_writer {
+    field_sequence_writer() noexcept;
+    ~field_sequence_writer();
+
+    field_sequence_writer(field_sequence_writer const &) = delete;
+    field_sequence_writer & operator = (field_sequence_writer const &) = delete;
+
+    // encoding_name is "vec2f" or "angle16", null for vec2f
+    int open(char const *path, char const *encoding_name, int grid_width, int grid_height) noexcept(false);
+    int append(djc::math::vec2f const *field, std::uint8_t const *shades, std::uint64_t step) noexcept;
+    void close() noexcept;
+
+    bool is_open() const noexcept;
+    std::uint64_t frames_written() const noexcept;
+
+private:
+    field_encoding m_encoding;
+    int m_fd;
+    std::size_t m_cell_count;
+    std::uint64_t m_frames_written;
+    std::vector<std::uint8_t> m_frame;
+};
+
+struct field_sequence_reader {
+    static constexpr std::uint64_t read_ahead_frames = 8;
+
+    field_sequence_reader() noexcept;
+    ~field_sequence_reader();
+
+    field_sequence_reader(field_sequence_reader const &) = delete;
+    field_sequence_reader & operator = (field_sequence_reader const &) = delete;
+
+    int open(char const *path) noexcept;
+    void close() noexcept;
+
+    // frame wraps around frame_count(), field and shades take grid_width * grid_height cells
+    int read_frame(std::uint64_t frame, djc::math::vec2f *field, std::uint8_t *shades) noexcept;
+    int read_step(std::uint64_t step, djc::math::vec2f *field, std::uint8_t *shades) noexcept; // wraps the same way
+
+    std::uint64_t frame_count() const noexcept;
+    std::uint64_t first_step() const noexcept;
+    field_encoding encoding() const noexcept;
+    int grid_width() const noexcept;
+    int grid_height() const noexcept;
+
+private:
+    unsigned char const *m_mapping;
+    std::size_t m_mapping_size;
+    field_encoding m_encoding;
+    int m_grid_width;
+    int m_grid_height;
+    std::uint64_t m_frame_size;
+    std::uint64_t m_frame_count;
+    std::uint64_t m_first_step;
+};
+
+#endif // field_sequence_hpp
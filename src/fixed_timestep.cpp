@@ -0,0 +1,34 @@
+#include "fixed_timestep.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+fixed_timestep::fixed_timestep(int hz, int max_substeps) noexcept
+:   hz{hz}
+,   max_substeps{std::max(max_substeps, 1)}
+,   step_seconds{hz > 0 ? 1.0 / hz : 0.0}
+,   accumulator{0.0} {
+
+}
+
+int fixed_timestep::advance(double frame_seconds) noexcept {
+    if (hz <= 0) {
+        return 1;
+    }
+
+    accumulator += std::max(frame_seconds, 0.0);
+    int steps = std::min(static_cast<int>(accumulator / step_seconds), max_substeps);
+    accumulator -= steps * step_seconds;
+
+    // over the substep cap - drop the whole steps still owed, keep the part of a step already done
+    if (accumulator >= step_seconds) {
+        accumulator = std::fmod(accumulator, step_seconds);
+    }
+
+    return steps;
+}
+
+float fixed_timestep::alpha() const noexcept {
+    return hz > 0 ? static_cast<float>(accumulator / step_seconds) : 1.0f;
+}
@@ -0,0 +1,29 @@
+#ifndef fixed_timestep_hpp
+#define fixed_timestep_hpp
+
+/* fixed timestep accumulator - decouples how often the simulation steps from how
+ often frames are rendered.
+
+ each frame advance() adds the real time the frame took and returns how many fixed
+ steps of 1 / hz seconds to run. at most max_substeps are run in one frame: when the
+ machine can not keep up the rest of the backlog is dropped, so the animation slows
+ down instead of every frame getting slower trying to catch up. alpha() is how far
+ the leftover time is into the next step (0 to 1), used to interpolate the drawn
+ particles between the previous and the current step.
+
+ hz of 0 is lockstep - one step per frame, whatever the frame took.
+*/
+
+struct fixed_timestep {
+    int hz;
+    int max_substeps;
+    double step_seconds;
+    double accumulator;
+
+    fixed_timestep(int hz, int max_substeps) noexcept;
+
+    int advance(double frame_seconds) noexcept;
+    float alpha() const noexcept;
+};
+
+#endif // fixed_timestep_hpp
@@ -0,0 +1,130 @@
+#include "flow_field_generator.hpp"
+
+// my
+#include "profiler.hpp"
+#include "tracer.hpp"
+
+flow_field_generator::flow_field_generator(simulation const & sim, thread_pool *workers) noexcept(false)
+:   m_sim{sim}
+,   m_workers{workers}
+,   m_buffers{}
+,   m_published{nullptr}
+,   m_reading{nullptr}
+,   m_mutex{}
+,   m_wake{}
+,   m_requested{sim.zstep}
+,   m_pending{false}
+,   m_stop{false}
+,   m_thread{} {
+
+    regrid();
+}
+
+flow_field_generator::~flow_field_generator() {
+    stop();
+}
+
+void flow_field_generator::start() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_thread.joinable()) {
+            return;
+        }
+
+        m_stop = false;
+    }
+
+    m_thread = std::thread(&flow_field_generator::thread_loop, this);
+}
+
+void flow_field_generator::stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void flow_field_generator::regrid() {
+    // allocated here, then only ever refilled until the grid changes
+    for (field_buffer & buffer : m_buffers) {
+        buffer.flow_field.assign(m_sim.flow_field.size(), djc::math::vec2f(0, 0));
+        buffer.shades.assign(m_sim.flow_field.size(), 0);
+        buffer.zstep = 0.0;
+    }
+
+    // so there is a field to acquire before the thread has built anything
+    fill(m_buffers[0], m_sim.zstep);
+    m_published.store(&m_buffers[0]);
+    m_reading.store(nullptr);
+}
+
+void flow_field_generator::request(double zstep) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requested = zstep;
+        m_pending = true;
+    }
+    m_wake.notify_one();
+}
+
+field_buffer const *flow_field_generator::acquire() noexcept {
+    // publish the hazard, then make sure the buffer was not replaced (and possibly picked
+    // up for refilling) in between - seq_cst so the generator sees the hazard before it chooses
+    for (;;) {
+        field_buffer *buffer = m_published.load();
+        m_reading.store(buffer);
+
+        if (m_published.load() == buffer) {
+            return buffer;
+        }
+    }
+}
+
+void flow_field_generator::fill(field_buffer & buffer, double zstep) {
+    stage_timer timer(frame_stage::noise_fill);
+    m_sim.fill_flow_field(zstep, buffer.flow_field.data(), buffer.shades.data(), nullptr, 0, m_workers);
+    buffer.zstep = zstep;
+}
+
+void flow_field_generator::thread_loop() {
+    for (;;) {
+        double zstep;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_pending || m_stop; });
+
+            if (m_stop) {
+                return;
+            }
+
+            zstep = m_requested;
+            m_pending = false;
+        }
+
+        // any buffer that is neither published nor held by the reader
+        field_buffer *published = m_published.load(std::memory_order_relaxed); // only this thread stores it
+        field_buffer *reading = m_reading.load();
+        field_buffer *target = nullptr;
+
+        for (field_buffer & buffer : m_buffers) {
+            if (&buffer != published && &buffer != reading) {
+                target = &buffer;
+                break;
+            }
+        }
+
+        {
+            trace_scope trace("flow field generate");
+            fill(*target, zstep);
+        }
+
+        m_published.store(target);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef flow_field_generator_hpp
+#define flow_field_generator_hpp
+
+// std
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+// my
+#include "djc_math/djc_math.hpp"
+#include "simulation.hpp"
+#include "thread_pool.hpp"
+
+/* builds flow fields on a background thread so the noise never runs on the step.
+
+ the simulation asks for the field at a z with request() (the newest request wins)
+ and steps on whatever acquire() returns - the newest field published so far. the
+ generator fills one of three recycled buffers and publishes it by storing its
+ pointer (rcu style), the reader never waits.
+
+ the reader marks the buffer it is using in a hazard pointer and checks it is still
+ the published one before using it. the generator never writes the published buffer
+ or the one the hazard points at, and with three buffers there is always a third
+ one free to fill. a buffer returned from acquire() stays valid until the next call.
+
+ one reader (the thread stepping the simulation) and the generator thread only.
+
+ regrid() reallocates the buffers after the simulation's grid changed. it is only safe
+ between stop() and start(), from the reader's thread.
+*/
+
+struct field_buffer {
+    std::vector<djc::math::vec2f> flow_field;
+    std::vector<std::uint8_t> shades;
+    double zstep;
+};
+
+struct flow_field_generator {
+    explicit flow_field_generator(simulation const & sim, thread_pool *workers = nullptr) noexcept(false);
+    ~flow_field_generator();
+
+    flow_field_generator(flow_field_generator const &) = delete;
+    flow_field_generator & operator = (flow_field_generator const &) = delete;
+
+    void start();
+    void stop() noexcept;
+
+    void regrid();
+    void request(double zstep);
+    field_buffer const *acquire() noexcept;
+
+private:
+    void thread_loop();
+    void fill(field_buffer & buffer, double zstep);
+
+    simulation const & m_sim;
+    thread_pool *m_workers;
+    field_buffer m_buffers[3];
+    std::atomic<field_buffer *> m_published;
+    std::atomic<field_buffer *> m_reading; // hazard pointer, null when the reader holds nothing
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    double m_requested;
+    bool m_pending;
+    bool m_stop;
+    std::thread m_thread;
+};
+
+#endif // flow_field_generator_hpp
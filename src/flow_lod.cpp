@@ -0,0 +1,145 @@
+#include "flow_lod.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+
+flow_lod::flow_lod() noexcept
+:   m_levels{}
+,   m_valid_levels{0}
+,   m_steps{~std::uint64_t(0)}
+,   m_cells_averaged{0} {
+
+}
+
+int flow_lod::level_for(float cell_pixels, float spacing) noexcept {
+    int chosen = 0;
+
+    while (cell_pixels < spacing && chosen < 30) {
+        cell_pixels *= 2.0f;
+        chosen++;
+    }
+
+    return chosen;
+}
+
+int flow_lod::update(sim_view const & sim, int level, thread_pool *workers) {
+    if (m_levels.empty() || m_levels[0].width != sim.grid_width || m_levels[0].height != sim.grid_height) {
+        resize(sim.grid_width, sim.grid_height);
+    }
+
+    level = std::clamp(level, 0, level_count() - 1);
+
+    if (level < m_valid_levels && sim.steps == m_steps) {
+        return level;
+    }
+
+    if (sim.steps != m_steps) {
+        // a new field - what was in line above level 0 only stays so where nothing under it changed
+        int in_line = m_valid_levels;
+        m_steps = sim.steps;
+
+        for (int i = 1; i <= level; i++) {
+            average(static_cast<std::size_t>(i), sim.flow_field, i >= in_line, workers);
+        }
+    } else {
+        // the same field, only further up the pyramid than before
+        for (int i = m_valid_levels; i <= level; i++) {
+            average(static_cast<std::size_t>(i), sim.flow_field, true, workers);
+        }
+    }
+
+    m_valid_levels = level + 1;
+    return level;
+}
+
+int flow_lod::level_count() const noexcept {
+    return static_cast<int>(m_levels.size());
+}
+
+int flow_lod::level_width(int level) const noexcept {
+    return m_levels[static_cast<std::size_t>(level)].width;
+}
+
+int flow_lod::level_height(int level) const noexcept {
+    return m_levels[static_cast<std::size_t>(level)].height;
+}
+
+djc::math::vec2f const *flow_lod::level_field(int level) const noexcept {
+    return m_levels[static_cast<std::size_t>(level)].field.data();
+}
+
+std::uint64_t flow_lod::cells_averaged() const noexcept {
+    return m_cells_averaged;
+}
+
+void flow_lod::resize(int grid_width, int grid_height) {
+    m_levels.clear();
+    m_valid_levels = 1;
+    m_steps = ~std::uint64_t(0);
+
+    int width = grid_width;
+    int height = grid_height;
+    m_levels.push_back(level{width, height, {}, {}});
+
+    while (width > 1 || height > 1) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+
+        std::size_t cells = static_cast<std::size_t>(width) * height;
+        m_levels.push_back(level{width, height, std::vector<djc::math::vec2f>(cells, djc::math::vec2f(0, 0)), std::vector<std::uint8_t>(cells, 0)});
+    }
+}
+
+void flow_lod::average(std::size_t index, djc::math::vec2f const *field, bool everything, thread_pool *workers) {
+    // level 1 reads the field and has no record of what changed, so it looks at every cell
+    struct level const & below = m_levels[index - 1];
+    struct level & target = m_levels[index];
+    djc::math::vec2f const *below_field = index == 1 ? field : below.field.data();
+    std::uint8_t const *below_changed = index == 1 ? nullptr : below.changed.data();
+    std::atomic<std::uint64_t> averaged{0};
+
+    auto average_row = [&](std::size_t row) {
+        int y1 = static_cast<int>(row) * 2;
+        int y2 = std::min(y1 + 1, below.height - 1);
+        std::uint64_t row_averaged = 0;
+
+        for (int x = 0; x < target.width; x++) {
+            int x1 = x * 2;
+            int x2 = std::min(x1 + 1, below.width - 1);
+            std::size_t a = static_cast<std::size_t>(y1) * below.width + x1;
+            std::size_t b = static_cast<std::size_t>(y1) * below.width + x2;
+            std::size_t c = static_cast<std::size_t>(y2) * below.width + x1;
+            std::size_t d = static_cast<std::size_t>(y2) * below.width + x2;
+            std::size_t out = row * static_cast<std::size_t>(target.width) + x;
+
+            if (below_changed && !everything && !(below_changed[a] | below_changed[b] | below_changed[c] | below_changed[d])) {
+                target.changed[out] = 0;
+                continue;
+            }
+
+            // an edge cell names the same child twice, count each child once
+            djc::math::vec2f sum = below_field[a];
+            float count = 1.0f;
+
+            if (x2 != x1) { sum += below_field[b]; count += 1.0f; }
+            if (y2 != y1) { sum += below_field[c]; count += 1.0f; }
+            if (x2 != x1 && y2 != y1) { sum += below_field[d]; count += 1.0f; }
+
+            djc::math::vec2f mean = sum / count;
+            target.changed[out] = everything || mean.x != target.field[out].x || mean.y != target.field[out].y;
+            target.field[out] = mean;
+            row_averaged++;
+        }
+
+        averaged += row_averaged;
+    };
+
+    if (workers) {
+        workers->parallel_for(static_cast<std::size_t>(target.height), average_row, "flow lod rows");
+    } else {
+        for (std::size_t row = 0; row < static_cast<std::size_t>(target.height); row++) average_row(row);
+    }
+
+    m_cells_averaged += averaged;
+}
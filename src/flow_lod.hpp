@@ -0,0 +1,64 @@
+#ifndef flow_lod_hpp
+#define flow_lod_hpp
+
+// std
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// my
+#include "djc_math/djc_math.hpp"
+#include "simulation.hpp"
+#include "thread_pool.hpp"
+
+/* a mip pyramid of the flow field, so the flow lines can be drawn at a spacing that
+ suits the screen rather than one line per grid cell.
+
+ level 0 is the field itself and is not kept, every level above has half the cells on
+ each axis (rounded up) and each of its cells is the average of the 2 x 2 cells under it
+ - the last row or column of an odd level averages the cells it has. averaging keeps
+ the length short where the cells underneath disagree, so turbulent areas draw as short
+ lines rather than as a direction none of them has.
+
+ level_for() picks the first level whose cells are at least spacing pixels apart on
+ screen, update() brings the levels up to that one in line with a new field. it is
+ incremental - level 1 is averaged from the field and compared with what it was, and
+ from there up only the parents of cells that changed are averaged again, so a field
+ that only moved in places (a world pan, a playback that holds still) costs one pass
+ over the field plus what changed. levels above the one asked for are left alone until
+ they are asked for. each level is split by rows over the thread pool.
+*/
+
+struct flow_lod {
+    flow_lod() noexcept;
+
+    // the level to draw when a grid cell is cell_pixels wide on screen
+    static int level_for(float cell_pixels, float spacing) noexcept;
+
+    // returns the level brought up to date - level, or the top one for a small field
+    int update(sim_view const & sim, int level, thread_pool *workers = nullptr);
+
+    int level_count() const noexcept;
+    int level_width(int level) const noexcept;
+    int level_height(int level) const noexcept;
+    djc::math::vec2f const *level_field(int level) const noexcept; // from level 1
+    std::uint64_t cells_averaged() const noexcept; // since construction
+
+private:
+    struct level {
+        int width;
+        int height;
+        std::vector<djc::math::vec2f> field;
+        std::vector<std::uint8_t> changed; // by the last update that reached this level
+    };
+
+    void resize(int grid_width, int grid_height);
+    void average(std::size_t index, djc::math::vec2f const *field, bool everything, thread_pool *workers);
+
+    std::vector<level> m_levels; // level 0 only has its size
+    int m_valid_levels;  // levels in line with the field of m_steps, level 0 always is
+    std::uint64_t m_steps;
+    std::uint64_t m_cells_averaged;
+};
+
+#endif // flow_lod_hpp
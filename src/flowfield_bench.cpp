@@ -0,0 +1,272 @@
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// my
+#include "sdl_module.hpp"
+#include "simulation.hpp"
+#include "render_passes.hpp"
+#include "thread_pool.hpp"
+#include "profiler.hpp"
+
+// dependancies
+#include "SDL2/SDL.h"
+
+/* end to end frame benchmark
+
+ runs the same per frame pipeline as main.cpp (particle update, noise fill, flow
+ lines, ghost trails, present) headless, for a fixed list of scenarios with a fixed
+ seed and frame count. every scenario writes the per stage and whole frame timings
+ to json, one line per stage, so two result files can be compared with diff or
+ with --baseline, which prints the change in p50 per stage and fails when any stage
+ got slower than --threshold percent.
+
+ usage: flowfield_bench [--frames <n>] [--filter <substring>] [--json <path>]
+                        [--baseline <path>] [--threshold <percent>]
+*/
+
+namespace {
+
+struct scenario {
+    char const *name;
+    int width;
+    int height;
+    int grid_divisor;
+    std::size_t particles;
+    bool software_ghost;
+    float zoom; // camera zoom on the middle of the area
+    float lod_spacing; // least flow line spacing on screen, 0 for a line per cell
+};
+
+scenario const g_scenarios[] = {
+    {"10k_640x460_d30",        640,  460,  30, 10000,   false, 1.0f, 0.0f},
+    {"100k_640x460_d30",       640,  460,  30, 100000,  false, 1.0f, 0.0f},
+    {"1m_640x460_d30",         640,  460,  30, 1000000, false, 1.0f, 0.0f},
+    {"100k_640x460_d30_cpu",   640,  460,  30, 100000,  true,  1.0f, 0.0f},
+    {"100k_1280x720_d10",      1280, 720,  10, 100000,  false, 1.0f, 0.0f},
+    {"100k_1920x1080_d20",     1920, 1080, 20, 100000,  false, 1.0f, 0.0f},
+    {"1m_1920x1080_d5_cpu",    1920, 1080, 5,  1000000, true,  1.0f, 0.0f},
+    {"1m_1920x1080_d5_cpu_x8", 1920, 1080, 5,  1000000, true,  8.0f, 0.0f},
+    {"100k_3840x2160_d2",      3840, 2160, 2,  100000,  false, 1.0f, 0.0f},
+    {"100k_3840x2160_d2_lod",  3840, 2160, 2,  100000,  false, 1.0f, 16.0f},
+};
+
+unsigned int const g_seed = 227;
+int const g_warm_up_frames = 10;
+
+struct stage_result {
+    std::string scenario;
+    std::string stage;
+    stage_stats stats;
+};
+
+//------------------------------------------------------------
+int
+run_scenario(scenario const & s, int frame_count, thread_pool & workers, std::vector<stage_result> & results) {
+    window_spec window{s.width, s.height, s.grid_divisor};
+    window.headless = true;
+
+    if (window.init() < 0) {
+        return -1;
+    }
+
+    simulation sim(window.renderer_width, window.renderer_height, s.grid_divisor, s.particles, g_seed);
+    render_passes passes(window, workers, sim, s.software_ghost);
+    frame_profiler profiler;
+    passes.camera.zoom_at(s.zoom, window.renderer_width * 0.5f, window.renderer_height * 0.5f);
+    passes.lod_spacing = s.lod_spacing;
+
+    auto frame = [&]() {
+        stage_timer frame_timer(frame_stage::frame);
+        
+        sim.tick(&workers);
+        passes.begin_frame();
+        passes.draw_perlin(sim.view());
+        passes.draw_flow_lines(sim.view());
+        passes.draw_ghost(sim.view());
+        passes.present(2);
+    };
+
+    profiler_enable(false);
+    for (int i = 0; i < g_warm_up_frames; i++) {
+        frame();
+    }
+
+    profiler_enable(true);
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < frame_count; i++) {
+        frame();
+        profiler.collect();
+    }
+
+    double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    profiler_enable(false);
+
+    auto stats = profiler.stats();
+
+    std::printf("\n%s (%zu particles, %dx%d grid, %d frames, %.1f fps)\n", s.name, s.particles, sim.grid_width, sim.grid_height, frame_count, frame_count * 1000.0 / total_ms);
+    std::printf("  %-16s %10s %10s %10s %10s %10s\n", "stage", "mean", "p50", "p95", "p99", "max");
+
+    for (std::size_t i = 0; i < stats.size(); i++) {
+        if (stats[i].samples == 0) {
+            continue;
+        }
+
+        char const *name = frame_stage_name(static_cast<frame_stage>(i));
+        std::printf("  %-16s %10.3f %10.3f %10.3f %10.3f %10.3f\n", name, stats[i].mean_ms, stats[i].p50_ms, stats[i].p95_ms, stats[i].p99_ms, stats[i].max_ms);
+        results.push_back(stage_result{s.name, name, stats[i]});
+    }
+
+    stage_stats total{};
+    total.samples = static_cast<std::size_t>(frame_count);
+    total.mean_ms = total.p50_ms = total.p95_ms = total.p99_ms = total.max_ms = total_ms;
+    results.push_back(stage_result{s.name, "total", total});
+    std::printf("  %-16s %10.3f\n", "total", total_ms);
+
+    return 0;
+}
+
+//------------------------------------------------------------
+int
+write_json(char const *path, std::vector<stage_result> const & results, int frame_count) {
+    std::FILE *file = std::fopen(path, "wb");
+
+    if (file == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open \"%s\"", path);
+        return -1;
+    }
+
+    std::fprintf(file, "{\n  \"suite\": \"flowfield\",\n  \"seed\": %u,\n  \"frames\": %d,\n  \"results\": [\n", g_seed, frame_count);
+
+    // one result per line keeps the file diffable and easy to read back in load_baseline
+    for (std::size_t i = 0; i < results.size(); i++) {
+        stage_result const & r = results[i];
+        std::fprintf(file, "    {\"scenario\": \"%s\", \"stage\": \"%s\", \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f}%s\n",
+            r.scenario.c_str(), r.stage.c_str(), r.stats.mean_ms, r.stats.p50_ms, r.stats.p95_ms, r.stats.p99_ms, r.stats.max_ms, i + 1 < results.size() ? "," : "");
+    }
+
+    std::fputs("  ]\n}\n", file);
+    return std::fclose(file) == 0 ? 0 : -1;
+}
+
+//------------------------------------------------------------
+int
+load_baseline(char const *path, std::vector<stage_result> & baseline) {
+    std::FILE *file = std::fopen(path, "rb");
+
+    if (file == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open baseline \"%s\"", path);
+        return -1;
+    }
+
+    char line[512];
+    
+    while (std::fgets(line, sizeof(line), file)) {
+        char scenario_name[128];
+        char stage_name[128];
+        stage_result r{};
+
+        if (std::sscanf(line, " {\"scenario\": \"%127[^\"]\", \"stage\": \"%127[^\"]\", \"mean_ms\": %lf, \"p50_ms\": %lf, \"p95_ms\": %lf, \"p99_ms\": %lf, \"max_ms\": %lf",
+                scenario_name, stage_name, &r.stats.mean_ms, &r.stats.p50_ms, &r.stats.p95_ms, &r.stats.p99_ms, &r.stats.max_ms) == 7) {
+            r.scenario = scenario_name;
+            r.stage = stage_name;
+            baseline.push_back(r);
+        }
+    }
+
+    std::fclose(file);
+    return 0;
+}
+
+//------------------------------------------------------------
+int
+compare_baseline(std::vector<stage_result> const & results, std::vector<stage_result> const & baseline, double threshold_percent) {
+    int regressions = 0;
+
+    std::printf("\n------- compared with baseline (p50) ------\n");
+
+    for (stage_result const & r : results) {
+        for (stage_result const & b : baseline) {
+            if (r.scenario != b.scenario || r.stage != b.stage || b.stats.p50_ms <= 0.0) {
+                continue;
+            }
+
+            double change = (r.stats.p50_ms - b.stats.p50_ms) / b.stats.p50_ms * 100.0;
+            bool regressed = change > threshold_percent;
+            regressions += regressed;
+
+            std::printf("%-24s %-16s %10.3f -> %10.3f ms %+8.1f%%%s\n", r.scenario.c_str(), r.stage.c_str(), b.stats.p50_ms, r.stats.p50_ms, change, regressed ? "  REGRESSION" : "");
+        }
+    }
+
+    return regressions;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int frame_count = 120;
+    char const *filter = nullptr;
+    char const *json_path = nullptr;
+    char const *baseline_path = nullptr;
+    double threshold_percent = 10.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frame_count = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold_percent = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr, "usage: %s [--frames <n>] [--filter <substring>] [--json <path>] [--baseline <path>] [--threshold <percent>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (SDL_Init(SDL_INIT_EVENTS | SDL_INIT_TIMER)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL Could not be initialised: %s", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    thread_pool workers;
+    std::vector<stage_result> results;
+
+    for (scenario const & s : g_scenarios) {
+        if (filter && std::strstr(s.name, filter) == nullptr) {
+            continue;
+        }
+
+        if (run_scenario(s, frame_count, workers, results) < 0) {
+            SDL_Quit();
+            return EXIT_FAILURE;
+        }
+    }
+
+    int status = EXIT_SUCCESS;
+
+    if (json_path && write_json(json_path, results, frame_count) < 0) {
+        status = EXIT_FAILURE;
+    }
+
+    if (baseline_path) {
+        std::vector<stage_result> baseline;
+
+        if (load_baseline(baseline_path, baseline) < 0 || compare_baseline(results, baseline, threshold_percent) > 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    SDL_Quit();
+    return status;
+}
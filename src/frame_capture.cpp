@@ -0,0 +1,507 @@
+#include "frame_capture.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <string>
+
+// posix
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+//------------------------------------------------------------
+bool
+ends_with(char const *text, char const *suffix) noexcept {
+    std::size_t text_length = std::strlen(text);
+    std::size_t suffix_length = std::strlen(suffix);
+    return text_length >= suffix_length && std::strcmp(text + text_length - suffix_length, suffix) == 0;
+}
+
+//------------------------------------------------------------
+// a frame number pattern has to be exactly one %d (optionally with a width, e.g. %05d)
+bool
+valid_frame_pattern(char const *pattern) noexcept {
+    char const *percent = std::strchr(pattern, '%');
+
+    if (!percent || std::strchr(percent + 1, '%')) {
+        return false;
+    }
+
+    char const *c = percent + 1;
+    while (*c >= '0' && *c <= '9') c++;
+    return *c == 'd';
+}
+
+//------------------------------------------------------------
+bool
+parse_format(char const *name, frame_capture::format & format) noexcept {
+    if (std::strcmp(name, "y4m") == 0)  { format = frame_capture::format::y4m;  return true; }
+    if (std::strcmp(name, "png") == 0)  { format = frame_capture::format::png;  return true; }
+    if (std::strcmp(name, "rgba") == 0) { format = frame_capture::format::rgba; return true; }
+    if (std::strcmp(name, "bgra") == 0) { format = frame_capture::format::bgra; return true; }
+    return false;
+}
+
+//------------------------------------------------------------
+// writev until everything is out - pipes take partial writes
+bool
+write_all(int fd, iovec *iov, int count) noexcept {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count); // count is at most buffer_count, well under IOV_MAX
+
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        while (count > 0 && static_cast<std::size_t>(written) >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+
+        if (count > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------
+std::uint32_t
+crc32(std::uint32_t crc, std::uint8_t const *data, std::size_t size) noexcept {
+    static std::uint32_t const *table = [] {
+        static std::uint32_t entries[256];
+
+        for (std::uint32_t n = 0; n < 256; n++) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            entries[n] = c;
+        }
+        return entries;
+    }();
+
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+//------------------------------------------------------------
+void
+put_u32_be(std::vector<std::uint8_t> & out, std::uint32_t value) {
+    out.push_back(static_cast<std::uint8_t>(value >> 24));
+    out.push_back(static_cast<std::uint8_t>(value >> 16));
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+//------------------------------------------------------------
+bool
+write_png_chunk(std::FILE *file, char const *type, std::uint8_t const *data, std::size_t size) noexcept {
+    std::uint8_t header[8] = {
+        static_cast<std::uint8_t>(size >> 24), static_cast<std::uint8_t>(size >> 16),
+        static_cast<std::uint8_t>(size >> 8), static_cast<std::uint8_t>(size),
+        static_cast<std::uint8_t>(type[0]), static_cast<std::uint8_t>(type[1]),
+        static_cast<std::uint8_t>(type[2]), static_cast<std::uint8_t>(type[3])
+    };
+
+    std::uint32_t crc = crc32(crc32(0, header + 4, 4), data, size);
+    std::uint8_t footer[4] = {
+        static_cast<std::uint8_t>(crc >> 24), static_cast<std::uint8_t>(crc >> 16),
+        static_cast<std::uint8_t>(crc >> 8), static_cast<std::uint8_t>(crc)
+    };
+
+    return std::fwrite(header, 1, 8, file) == 8
+        && (size == 0 || std::fwrite(data, 1, size, file) == size)
+        && std::fwrite(footer, 1, 4, file) == 4;
+}
+
+} // namespace
+
+frame_capture::frame_capture() noexcept
+:   m_format{format::rgba}
+,   m_path{}
+,   m_width{0}
+,   m_height{0}
+,   m_fps{0}
+,   m_fd{-1}
+,   m_owns_fd{false}
+,   m_buffers{}
+,   m_scratch{}
+,   m_full{}
+,   m_free{}
+,   m_mutex{}
+,   m_wake_encoder{}
+,   m_wake_capture{}
+,   m_stop{false}
+,   m_failed{false}
+,   m_frames_written{0}
+,   m_frames_captured{0}
+,   m_encoder{} {
+
+}
+
+frame_capture::~frame_capture() {
+    close();
+}
+
+int frame_capture::open(char const *path, char const *format_name, int width, int height, int fps) noexcept(false) {
+    if (is_open()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "capture is already open");
+        return -1;
+    }
+
+    bool to_stdout = std::strcmp(path, "-") == 0;
+
+    if (format_name) {
+        if (!parse_format(format_name, m_format)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "unknown capture format \"%s\" (y4m, png, rgba or bgra)", format_name);
+            return -1;
+        }
+    } else {
+        m_format = to_stdout || ends_with(path, ".y4m") ? format::y4m
+                 : ends_with(path, ".png")  ? format::png
+                 : ends_with(path, ".bgra") ? format::bgra
+                 : format::rgba;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_fps = fps > 0 ? fps : 60;
+
+    if (m_format == format::png) {
+        if (to_stdout) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "a png sequence can not be streamed to stdout");
+            return -1;
+        }
+
+        // frame_%05d.png as given, otherwise frame.png becomes frame_%06d.png
+        std::string pattern(path);
+
+        if (!std::strchr(path, '%')) {
+            pattern.insert(ends_with(path, ".png") ? pattern.size() - 4 : pattern.size(), "_%06d");
+        }
+
+        if (!valid_frame_pattern(pattern.c_str())) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "capture path \"%s\" needs exactly one %%d for the frame number", path);
+            return -1;
+        }
+
+        m_path.assign(pattern.begin(), pattern.end());
+        m_path.push_back('\0');
+    } else {
+        // a named pipe blocks here until the consumer opens its end
+        m_fd = to_stdout ? STDOUT_FILENO : ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        m_owns_fd = !to_stdout;
+
+        if (m_fd < 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open capture output \"%s\": %s", path, std::strerror(errno));
+            return -1;
+        }
+
+        struct stat info;
+        if (fstat(m_fd, &info) == 0 && S_ISFIFO(info.st_mode)) {
+            // a consumer that goes away should fail the write, not kill the process
+            std::signal(SIGPIPE, SIG_IGN);
+#if defined(__linux__)
+            fcntl(m_fd, F_SETPIPE_SZ, 1 << 20); // best effort, fewer wake ups per frame
+#endif
+        }
+
+        if (m_format == format::y4m) {
+            char header[128];
+            int length = std::snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", m_width, m_height, m_fps);
+            iovec iov{header, static_cast<std::size_t>(length)};
+
+            if (!write_all(m_fd, &iov, 1)) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not write to capture output \"%s\": %s", path, std::strerror(errno));
+                if (m_owns_fd) ::close(m_fd);
+                m_fd = -1;
+                return -1;
+            }
+        }
+    }
+
+    // the whole pool up front, capture() never allocates
+    m_buffers.assign(buffer_count, std::vector<std::uint8_t>(static_cast<std::size_t>(width) * height * 4));
+
+    for (std::size_t i = 0; i < buffer_count; i++) {
+        m_free.push(i);
+    }
+
+    m_stop.store(false);
+    m_failed.store(false);
+    m_frames_written.store(0);
+    m_frames_captured = 0;
+    m_encoder = std::thread(&frame_capture::encoder_loop, this);
+    return 0;
+}
+
+int frame_capture::capture(SDL_Renderer *renderer) noexcept {
+    if (!is_open() || m_failed.load(std::memory_order_relaxed)) {
+        return -1;
+    }
+
+    // back pressure - wait for the encoder to hand a buffer back
+    std::size_t index;
+
+    while (!m_free.pop(index)) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake_capture.wait_for(lock, std::chrono::milliseconds(1));
+
+        if (m_failed.load(std::memory_order_relaxed)) {
+            return -1;
+        }
+    }
+
+    std::vector<std::uint8_t> & buffer = m_buffers[index];
+    Uint32 pixel_format = m_format == format::bgra ? SDL_PIXELFORMAT_BGRA32 : SDL_PIXELFORMAT_RGBA32;
+    int result = SDL_RenderReadPixels(renderer, nullptr, pixel_format, buffer.data(), m_width * 4);
+
+    if (result < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not read the frame back for capture: %s", SDL_GetError());
+        std::fill(buffer.begin(), buffer.end(), std::uint8_t(0)); // keep the frame count right, write a black frame
+    }
+
+    // can not fail, there are only as many buffers as ring slots
+    m_full.push(index);
+    m_wake_encoder.notify_one();
+    m_frames_captured++;
+    return result < 0 ? -1 : 0;
+}
+
+void frame_capture::close() noexcept {
+    if (!is_open()) {
+        return;
+    }
+
+    // the encoder drains everything already captured before it stops
+    m_stop.store(true);
+    m_wake_encoder.notify_one();
+    m_encoder.join();
+
+    if (m_owns_fd && m_fd >= 0) {
+        ::close(m_fd);
+    }
+
+    m_fd = -1;
+    m_owns_fd = false;
+
+    // every buffer is back in the free ring, empty it for the next open()
+    std::size_t index;
+    while (m_free.pop(index)) {}
+
+    m_buffers.clear();
+    m_buffers.shrink_to_fit();
+    SDL_Log("capture: wrote %llu of %llu frames",
+            static_cast<unsigned long long>(m_frames_written.load()), static_cast<unsigned long long>(m_frames_captured));
+}
+
+bool frame_capture::is_open() const noexcept {
+    return m_encoder.joinable();
+}
+
+bool frame_capture::failed() const noexcept {
+    return m_failed.load(std::memory_order_relaxed);
+}
+
+std::uint64_t frame_capture::frames_written() const noexcept {
+    return m_frames_written.load(std::memory_order_relaxed);
+}
+
+void frame_capture::encoder_loop() noexcept {
+    // the raw formats write everything waiting in one go, the others a frame at a time
+    std::size_t batch_limit = m_format == format::rgba || m_format == format::bgra ? buffer_count : 1;
+
+    for (;;) {
+        std::size_t batch[buffer_count];
+        std::size_t count = 0;
+
+        while (count < batch_limit && m_full.pop(batch[count])) {
+            count++;
+        }
+
+        if (count > 0) {
+            if (!m_failed.load(std::memory_order_relaxed)) {
+                if (write_frames(batch, count)) {
+                    m_frames_written.fetch_add(count, std::memory_order_relaxed);
+                } else {
+                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "capture: writing frame %llu failed (%s), stopping",
+                                 static_cast<unsigned long long>(m_frames_written.load()), std::strerror(errno));
+                    m_failed.store(true);
+                }
+            }
+
+            for (std::size_t i = 0; i < count; i++) {
+                m_free.push(batch[i]);
+            }
+
+            m_wake_capture.notify_one();
+            continue;
+        }
+
+        if (m_stop.load()) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake_encoder.wait_for(lock, std::chrono::milliseconds(2));
+    }
+}
+
+bool frame_capture::write_frames(std::size_t const *indices, std::size_t count) noexcept {
+    switch (m_format) {
+        case format::y4m: return write_y4m(m_buffers[indices[0]].data());
+        case format::png: return write_png(m_buffers[indices[0]].data());
+        case format::rgba:
+        case format::bgra: {
+            // straight out of the capture buffers
+            iovec iov[buffer_count];
+
+            for (std::size_t i = 0; i < count; i++) {
+                iov[i].iov_base = m_buffers[indices[i]].data();
+                iov[i].iov_len = m_buffers[indices[i]].size();
+            }
+
+            return write_all(m_fd, iov, static_cast<int>(count));
+        }
+    }
+
+    return false;
+}
+
+bool frame_capture::write_y4m(std::uint8_t const *rgba) noexcept {
+    // full range bt.601 in 8.8 fixed point, chroma from the average of each 2x2 block
+    int chroma_width = (m_width + 1) / 2;
+    int chroma_height = (m_height + 1) / 2;
+    std::size_t luma_size = static_cast<std::size_t>(m_width) * m_height;
+    std::size_t chroma_size = static_cast<std::size_t>(chroma_width) * chroma_height;
+    m_scratch.resize(luma_size + chroma_size * 2);
+
+    std::uint8_t *y_plane = m_scratch.data();
+    std::uint8_t *u_plane = y_plane + luma_size;
+    std::uint8_t *v_plane = u_plane + chroma_size;
+
+    for (std::size_t i = 0; i < luma_size; i++) {
+        std::uint8_t const *p = rgba + i * 4;
+        y_plane[i] = static_cast<std::uint8_t>((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+    }
+
+    for (int cy = 0; cy < chroma_height; cy++) {
+        for (int cx = 0; cx < chroma_width; cx++) {
+            int r = 0, g = 0, b = 0, n = 0;
+
+            for (int y = cy * 2; y < std::min(cy * 2 + 2, m_height); y++) {
+                for (int x = cx * 2; x < std::min(cx * 2 + 2, m_width); x++) {
+                    std::uint8_t const *p = rgba + (static_cast<std::size_t>(y) * m_width + x) * 4;
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                    n++;
+                }
+            }
+
+            r /= n;
+            g /= n;
+            b /= n;
+
+            // offset by 128 << 8 up front so the shifts never see a negative number
+            std::size_t index = static_cast<std::size_t>(cy) * chroma_width + cx;
+            u_plane[index] = static_cast<std::uint8_t>(std::min((-43 * r - 85 * g + 128 * b + 32896) >> 8, 255));
+            v_plane[index] = static_cast<std::uint8_t>(std::min((128 * r - 107 * g - 21 * b + 32896) >> 8, 255));
+        }
+    }
+
+    static char frame_header[] = "FRAME\n";
+    iovec iov[2] = {
+        {frame_header, sizeof(frame_header) - 1},
+        {m_scratch.data(), m_scratch.size()}
+    };
+
+    return write_all(m_fd, iov, 2);
+}
+
+bool frame_capture::write_png(std::uint8_t const *rgba) noexcept {
+    char name[4096];
+    std::snprintf(name, sizeof(name), m_path.data(), static_cast<int>(m_frames_written.load(std::memory_order_relaxed)));
+
+    std::FILE *file = std::fopen(name, "wb");
+
+    if (!file) {
+        return false;
+    }
+
+    // zlib stream of stored (uncompressed) deflate blocks - no compression library needed,
+    // and the encoder keeps up with the frame rate
+    std::size_t row_size = static_cast<std::size_t>(m_width) * 4 + 1;
+    std::size_t raw_size = row_size * m_height;
+    m_scratch.clear();
+    m_scratch.reserve(2 + raw_size + (raw_size / 65535 + 1) * 5 + 4);
+    m_scratch.push_back(0x78);
+    m_scratch.push_back(0x01);
+
+    std::uint32_t adler_a = 1;
+    std::uint32_t adler_b = 0;
+    std::size_t adler_pending = 0;
+    std::size_t block_left = 0;
+    std::size_t raw_left = raw_size;
+
+    auto put = [&](std::uint8_t byte) {
+        if (block_left == 0) {
+            std::size_t block = std::min<std::size_t>(raw_left, 65535);
+            m_scratch.push_back(block == raw_left ? 1 : 0); // final block flag, stored type
+            m_scratch.push_back(static_cast<std::uint8_t>(block));
+            m_scratch.push_back(static_cast<std::uint8_t>(block >> 8));
+            m_scratch.push_back(static_cast<std::uint8_t>(~block));
+            m_scratch.push_back(static_cast<std::uint8_t>(~block >> 8));
+            block_left = block;
+        }
+
+        // the adler sums only need reducing every 5552 bytes before they can overflow
+        m_scratch.push_back(byte);
+        adler_a += byte;
+        adler_b += adler_a;
+
+        if (++adler_pending == 5552) {
+            adler_a %= 65521;
+            adler_b %= 65521;
+            adler_pending = 0;
+        }
+
+        block_left--;
+        raw_left--;
+    };
+
+    for (int y = 0; y < m_height; y++) {
+        put(0); // filter: none
+        std::uint8_t const *row = rgba + static_cast<std::size_t>(y) * m_width * 4;
+        for (std::size_t i = 0; i < static_cast<std::size_t>(m_width) * 4; i++) put(row[i]);
+    }
+
+    put_u32_be(m_scratch, ((adler_b % 65521) << 16) | (adler_a % 65521));
+
+    std::uint8_t const ihdr[13] = {
+        static_cast<std::uint8_t>(m_width >> 24), static_cast<std::uint8_t>(m_width >> 16),
+        static_cast<std::uint8_t>(m_width >> 8), static_cast<std::uint8_t>(m_width),
+        static_cast<std::uint8_t>(m_height >> 24), static_cast<std::uint8_t>(m_height >> 16),
+        static_cast<std::uint8_t>(m_height >> 8), static_cast<std::uint8_t>(m_height),
+        8, 6, 0, 0, 0 // 8 bit, rgba, deflate, no filter, no interlace
+    };
+
+    static std::uint8_t const signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    bool ok = std::fwrite(signature, 1, 8, file) == 8
+           && write_png_chunk(file, "IHDR", ihdr, sizeof(ihdr))
+           && write_png_chunk(file, "IDAT", m_scratch.data(), m_scratch.size())
+           && write_png_chunk(file, "IEND", nullptr, 0);
+
+    return std::fclose(file) == 0 && ok;
+}
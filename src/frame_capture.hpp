@@ -0,0 +1,100 @@
+#ifndef frame_capture_hpp
+#define frame_capture_hpp
+
+// std
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstddef>
+
+// my
+#include "spsc_ring.hpp"
+
+// dependancies
+#include "SDL2/SDL.h"
+
+/* records the composed frames to disk without doing the encoding on the render thread.
+
+ capture() reads the frame the renderer just composed (the off screen surface when
+ headless) into one of a fixed pool of buffers allocated in open(), and hands the
+ buffer to an encoder thread through a lock free spsc ring. the encoder writes it out
+ and gives the buffer back through a second ring. nothing is allocated per frame -
+ when every buffer is still waiting to be written capture() waits for one (back
+ pressure) rather than dropping frames or growing the pool. main.cpp steps the
+ simulation once per frame while capturing, so every frame is one step and the y4m
+ frame rate is the fps given to open() (sim_hz) however fast the frames are drawn.
+
+ the format is y4m, png, rgba or bgra - given by name (which wins over the extension),
+ or taken from the path:
+    *.y4m   yuv4mpeg2 video, 4:2:0 full range bt.601, marked XCOLORRANGE=FULL in the header so
+            players do not stretch it again (ffmpeg / mpv read it directly)
+    *.png   png sequence, path is a printf pattern for the frame number (frame_%05d.png),
+            or _%06d is added before the extension when it has none
+    *.bgra  raw bgra, every frame back to back
+    other   raw rgba, every frame back to back
+
+ the stream formats (y4m, rgba, bgra) can go to stdout (path "-", y4m unless a format is
+ given) or a named pipe, for piping into an external encoder. frames are written with
+ writev straight out of the capture buffers - the raw formats are read back from the
+ renderer in the output byte order so they are never touched on the way, and every
+ frame waiting in the ring goes out in a single writev. a slow consumer fills the pipe,
+ the encoder blocks in writev and back pressure slows the frames down to the consumer.
+ if the consumer goes away failed() turns true.
+*/
+
+struct frame_capture {
+    enum class format {
+        y4m,
+        png,
+        rgba,
+        bgra
+    };
+
+    static constexpr std::size_t buffer_count = 8;
+
+    frame_capture() noexcept;
+    ~frame_capture();
+
+    frame_capture(frame_capture const &) = delete;
+    frame_capture & operator = (frame_capture const &) = delete;
+
+    int open(char const *path, char const *format_name, int width, int height, int fps) noexcept(false); // format_name can be null
+    int capture(SDL_Renderer *renderer) noexcept;
+    void close() noexcept;
+
+    bool is_open() const noexcept;
+    bool failed() const noexcept;
+    std::uint64_t frames_written() const noexcept;
+
+private:
+    void encoder_loop() noexcept;
+    bool write_frames(std::size_t const *indices, std::size_t count) noexcept;
+    bool write_y4m(std::uint8_t const *rgba) noexcept;
+    bool write_png(std::uint8_t const *rgba) noexcept;
+
+    format m_format;
+    std::vector<char> m_path;
+    int m_width;
+    int m_height;
+    int m_fps;
+    int m_fd;        // stream formats, -1 for png
+    bool m_owns_fd;  // false for stdout
+    std::vector<std::vector<std::uint8_t>> m_buffers;
+    std::vector<std::uint8_t> m_scratch; // encoder side only (yuv planes / png rows)
+    spsc_ring<std::size_t, buffer_count> m_full;
+    spsc_ring<std::size_t, buffer_count> m_free;
+    std::mutex m_mutex; // only for sleeping, the rings are lock free
+    std::condition_variable m_wake_encoder;
+    std::condition_variable m_wake_capture;
+    std::atomic<bool> m_stop;
+    std::atomic<bool> m_failed;
+    std::atomic<std::uint64_t> m_frames_written;
+    std::uint64_t m_frames_captured;
+    std::thread m_encoder;
+};
+
+#endif // frame_capture_hpp
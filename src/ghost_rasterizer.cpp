@@ -0,0 +1,166 @@
+#include "ghost_rasterizer.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+//------------------------------------------------------------
+inline std::uint32_t
+pack_argb(Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    return (std::uint32_t(a) << 24) | (std::uint32_t(r) << 16) | (std::uint32_t(g) << 8) | std::uint32_t(b);
+}
+
+//------------------------------------------------------------
+inline std::uint32_t
+blend_channel(std::uint32_t src, std::uint32_t dst, std::uint32_t alpha) {
+    return (src * alpha + dst * (255 - alpha) + 127) / 255;
+}
+
+//------------------------------------------------------------
+// SDL_BLENDMODE_BLEND: dstRGB = srcRGB * srcA + dstRGB * (1 - srcA), dstA = srcA + dstA * (1 - srcA)
+inline void
+blend_pixel(std::uint32_t & dst, SDL_Color const & src, float coverage) {
+    std::uint32_t alpha = static_cast<std::uint32_t>(src.a * coverage + 0.5f);
+
+    if (alpha == 0) {
+        return;
+    }
+
+    std::uint32_t a = blend_channel(255,   (dst >> 24) & 0xff, alpha);
+    std::uint32_t r = blend_channel(src.r, (dst >> 16) & 0xff, alpha);
+    std::uint32_t g = blend_channel(src.g, (dst >> 8)  & 0xff, alpha);
+    std::uint32_t b = blend_channel(src.b,  dst        & 0xff, alpha);
+
+    dst = (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+} // namespace
+
+ghost_rasterizer::ghost_rasterizer(int width, int height, int tile_size) noexcept(false)
+:   width{width}
+,   height{height}
+,   tile_size{tile_size}
+,   tiles_x{(width + tile_size - 1) / tile_size}
+,   tiles_y{(height + tile_size - 1) / tile_size}
+,   pixels(static_cast<std::size_t>(width) * height, pack_argb(0, 0, 0, 255))
+,   segments{}
+,   tile_bins(static_cast<std::size_t>(tiles_x) * tiles_y)
+,   colour{0, 0, 0, 255} {
+
+}
+
+void ghost_rasterizer::clear(Uint8 r, Uint8 g, Uint8 b, Uint8 a) noexcept {
+    std::fill(pixels.begin(), pixels.end(), pack_argb(r, g, b, a));
+}
+
+void ghost_rasterizer::begin(Uint8 r, Uint8 g, Uint8 b, Uint8 a) noexcept {
+    colour = SDL_Color{r, g, b, a};
+    segments.clear(); // keeps capacity, so steady state frames do not allocate
+}
+
+void ghost_rasterizer::push(float x1, float y1, float x2, float y2) {
+    segments.push_back(segment{x1, y1, x2, y2});
+}
+
+void ghost_rasterizer::rasterize(thread_pool & pool) {
+    bin_segments();
+    
+    pool.parallel_for(tile_bins.size(), [this](std::size_t tile) {
+        rasterize_tile(static_cast<int>(tile));
+    }, "ghost tiles");
+}
+
+int ghost_rasterizer::upload(SDL_Texture *texture) const noexcept {
+    if (SDL_UpdateTexture(texture, NULL, pixels.data(), static_cast<int>(sizeof(std::uint32_t)) * width) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", SDL_GetError());
+        return -1;
+    }
+    return 0;
+}
+
+void ghost_rasterizer::bin_segments() {
+    for (std::vector<std::uint32_t> & bin : tile_bins) {
+        bin.clear();
+    }
+
+    for (std::size_t i = 0; i < segments.size(); i++) {
+        segment const & s = segments[i];
+
+        // pixel bounding box grown by one for the anti aliased neighbour pixel
+        int min_x = static_cast<int>(std::floor(std::min(s.x1, s.x2))) - 1;
+        int max_x = static_cast<int>(std::floor(std::max(s.x1, s.x2))) + 1;
+        int min_y = static_cast<int>(std::floor(std::min(s.y1, s.y2))) - 1;
+        int max_y = static_cast<int>(std::floor(std::max(s.y1, s.y2))) + 1;
+
+        if (max_x < 0 || max_y < 0 || min_x >= width || min_y >= height) {
+            continue;
+        }
+
+        int tile_x0 = std::max(min_x, 0) / tile_size;
+        int tile_y0 = std::max(min_y, 0) / tile_size;
+        int tile_x1 = std::min(max_x, width - 1) / tile_size;
+        int tile_y1 = std::min(max_y, height - 1) / tile_size;
+
+        for (int ty = tile_y0; ty <= tile_y1; ty++) {
+            for (int tx = tile_x0; tx <= tile_x1; tx++) {
+                tile_bins[ty * tiles_x + tx].push_back(static_cast<std::uint32_t>(i));
+            }
+        }
+    }
+}
+
+void ghost_rasterizer::rasterize_tile(int tile_index) noexcept {
+    int tile_x0 = (tile_index % tiles_x) * tile_size;
+    int tile_y0 = (tile_index / tiles_x) * tile_size;
+    int tile_x1 = std::min(tile_x0 + tile_size, width);
+    int tile_y1 = std::min(tile_y0 + tile_size, height);
+
+    for (std::uint32_t segment_index : tile_bins[tile_index]) {
+        segment s = segments[segment_index];
+
+        // walk along the major axis, so swap x and y for steep lines
+        bool steep = std::abs(s.y2 - s.y1) > std::abs(s.x2 - s.x1);
+        
+        if (steep) {
+            std::swap(s.x1, s.y1);
+            std::swap(s.x2, s.y2);
+        }
+
+        if (s.x1 > s.x2) {
+            std::swap(s.x1, s.x2);
+            std::swap(s.y1, s.y2);
+        }
+
+        float dx = s.x2 - s.x1;
+        float gradient = dx == 0.0f ? 0.0f : (s.y2 - s.y1) / dx;
+
+        // only step over the part of the major axis that lands in this tile
+        int major_lo = steep ? tile_y0 : tile_x0;
+        int major_hi = steep ? tile_y1 : tile_x1;
+        int minor_lo = steep ? tile_x0 : tile_y0;
+        int minor_hi = steep ? tile_x1 : tile_y1;
+        int start = std::max(static_cast<int>(std::lround(s.x1)), major_lo);
+        int end   = std::min(static_cast<int>(std::lround(s.x2)), major_hi - 1);
+
+        for (int major = start; major <= end; major++) {
+            float minor = s.y1 + gradient * (major - s.x1);
+            int minor_floor = static_cast<int>(std::floor(minor));
+            float frac = minor - minor_floor;
+
+            for (int k = 0; k < 2; k++) {
+                int m = minor_floor + k;
+                
+                if (m < minor_lo || m >= minor_hi) {
+                    continue;
+                }
+                
+                float coverage = k == 0 ? 1.0f - frac : frac;
+                std::size_t index = steep ? static_cast<std::size_t>(major) * width + m : static_cast<std::size_t>(m) * width + major;
+                blend_pixel(pixels[index], colour, coverage);
+            }
+        }
+    }
+}
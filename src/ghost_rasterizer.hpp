@@ -0,0 +1,57 @@
+#ifndef ghost_rasterizer_hpp
+#define ghost_rasterizer_hpp
+
+// std
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// my
+#include "thread_pool.hpp"
+
+// dependancies
+#include "SDL2/SDL.h"
+
+/* cpu replacement for drawing the ghost trails through the SDL renderer.
+
+ segments are pushed for the frame, binned into square screen tiles and then each
+ tile is rasterised on its own thread into an owned ARGB8888 buffer. lines are anti
+ aliased (xiaolin wu - two pixels per step along the major axis weighted by coverage)
+ and alpha blended the same way as SDL_BLENDMODE_BLEND. segments are always drawn in
+ push order inside a tile, so the result does not depend on the thread count.
+
+ the finished buffer is uploaded to a texture once per frame with upload().
+*/
+
+struct ghost_rasterizer {
+    struct segment {
+        float x1;
+        float y1;
+        float x2;
+        float y2;
+    };
+
+    int width;
+    int height;
+    int tile_size;
+    int tiles_x;
+    int tiles_y;
+    std::vector<std::uint32_t> pixels;
+    std::vector<segment> segments;
+    std::vector<std::vector<std::uint32_t>> tile_bins;
+    SDL_Color colour;
+
+    ghost_rasterizer(int width, int height, int tile_size = 64) noexcept(false);
+
+    void clear(Uint8 r, Uint8 g, Uint8 b, Uint8 a) noexcept;
+    void begin(Uint8 r, Uint8 g, Uint8 b, Uint8 a) noexcept;
+    void push(float x1, float y1, float x2, float y2);
+    void rasterize(thread_pool & pool);
+    int upload(SDL_Texture *texture) const noexcept;
+
+private:
+    void bin_segments();
+    void rasterize_tile(int tile_index) noexcept;
+};
+
+#endif // ghost_rasterizer_hpp
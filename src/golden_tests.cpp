@@ -0,0 +1,181 @@
+// std
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// my
+#include "simulation.hpp"
+#include "ghost_rasterizer.hpp"
+#include "thread_pool.hpp"
+
+/* golden frame tests - the simulation has to come out bit identical for any thread count.
+
+ each configuration is stepped headless for a fixed number of frames the same way the
+ app does (particles, flow field + perlin pixels, software ghost trails, step) and two
+ hashes are taken at the end: the simulation state (simulation::state_hash) and the
+ frame (the perlin and ghost pixel buffers). both have to match the checked in golden
+ values on every thread count. the build flags keep float contraction off, so debug
+ and release builds have to match too.
+
+ the lifetime entries also let particles die and be born again through each emitter,
+ which covers the per chunk free lists and random streams of the respawn - the image
+ emitter is given a ring of weights drawn by weights_ring().
+
+ the golden values come from glibc's libm - sin / cos are not correctly rounded, so
+ another c library can legitimately produce different bits. when a change is meant to
+ alter the output, run with --print and paste the new table in.
+
+ usage: golden_tests [--print]
+*/
+
+namespace {
+
+struct golden {
+    char const *name;
+    int width;
+    int height;
+    int grid_divisor;
+    std::size_t particle_count;
+    unsigned int seed;
+    int frames;
+    std::uint32_t lifetime; // 0 lives forever
+    char const *emitter;    // uniform, edges or image
+    std::uint64_t state_hash;
+    std::uint64_t frame_hash;
+};
+
+golden const goldens[] = {
+    {"640x460 d30 10k particles",            640, 460, 30, 10000, 227, 120,  0, "uniform", 0xa15bc3a73ed95a85ull, 0x09b624d44899d34eull},
+    {"1280x720 d10 50k particles",          1280, 720, 10, 50000,   7,  60,  0, "uniform", 0xf1501fe9439c030cull, 0x8477713c12514c60ull},
+    {"97x61 d7 3k particles",                 97,  61,  7,  3000,   1, 200,  0, "uniform", 0x30df52327eb75539ull, 0xd40e7423a97a6e68ull},
+    {"640x460 d20 20k lifetime 40 uniform",  640, 460, 20, 20000,   3, 120, 40, "uniform", 0xa0389c8607af443dull, 0xcc3db84a157f8781ull},
+    {"640x460 d20 20k lifetime 25 edges",    640, 460, 20, 20000,   4, 120, 25, "edges",   0xc052817d3aa44c25ull, 0x07d5aefc6dd1a150ull},
+    {"640x460 d20 20k lifetime 60 image",    640, 460, 20, 20000,   5, 150, 60, "image",   0x6453046de62946caull, 0x0458a61cf7588dd8ull},
+};
+
+std::size_t const worker_counts[] = {0, 1, 3, 7};
+
+//------------------------------------------------------------
+std::uint64_t
+hash_pixels(std::uint64_t hash, std::vector<std::uint32_t> const & pixels) noexcept {
+    for (std::uint32_t pixel : pixels) {
+        for (int byte = 0; byte < 4; byte++) {
+            hash ^= (pixel >> (byte * 8)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------
+// a bright ring on black, so the image emitter has pixels it must never pick
+std::vector<std::uint8_t>
+weights_ring(int width, int height) {
+    std::vector<std::uint8_t> weights(static_cast<std::size_t>(width) * height);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int dx = x * 2 - width;
+            int dy = y * 2 - height;
+            int r2 = dx * dx + dy * dy;
+            int outer = std::min(width, height) * 3 / 4;
+            int inner = outer / 2;
+            weights[static_cast<std::size_t>(y) * width + x] = r2 < outer * outer && r2 >= inner * inner ? static_cast<std::uint8_t>(64 + (x * 191) / width) : 0;
+        }
+    }
+
+    return weights;
+}
+
+//------------------------------------------------------------
+void
+run(golden const & g, thread_pool & workers, std::uint64_t & state_hash, std::uint64_t & frame_hash) {
+    simulation sim(g.width, g.height, g.grid_divisor, g.particle_count, g.seed);
+    ghost_rasterizer ghost(g.width, g.height);
+    std::vector<std::uint32_t> perlin_pixels(static_cast<std::size_t>(sim.grid_width) * sim.grid_height);
+    int perlin_pitch = sim.grid_width * static_cast<int>(sizeof(std::uint32_t));
+
+    ghost.clear(255, 255, 255, 255);
+    sim.lifetime = g.lifetime;
+
+    if (std::strcmp(g.emitter, "image") == 0) {
+        std::vector<std::uint8_t> weights = weights_ring(48, 32);
+        sim.emitter.load_weights(weights.data(), 48, 32);
+    } else {
+        sim.emitter.set_kind(g.emitter);
+    }
+
+    for (int frame = 0; frame < g.frames; frame++) {
+        sim.update_particles(&workers);
+        sim.update_flow_field(perlin_pixels.data(), perlin_pitch, &workers);
+
+        ghost.begin(0, 0, 0, 10);
+
+        for (particle const & p : sim.particles) {
+            ghost.push(p.last_position.x, p.last_position.y, p.current_position.x, p.current_position.y);
+        }
+
+        ghost.rasterize(workers);
+        sim.step();
+    }
+
+    state_hash = sim.state_hash();
+    frame_hash = hash_pixels(hash_pixels(14695981039346656037ull, perlin_pixels), ghost.pixels);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    bool print = argc > 1 && std::strcmp(argv[1], "--print") == 0;
+
+    if (argc > 1 && !print) {
+        std::fprintf(stderr, "usage: %s [--print]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+
+    for (golden const & g : goldens) {
+        std::uint64_t first_state = 0;
+        std::uint64_t first_frame = 0;
+
+        for (std::size_t worker_count : worker_counts) {
+            thread_pool workers(worker_count);
+            std::uint64_t state = 0;
+            std::uint64_t frame = 0;
+            run(g, workers, state, frame);
+
+            if (print) {
+                first_state = state;
+                first_frame = frame;
+                break;
+            }
+
+            bool ok = state == g.state_hash && frame == g.frame_hash;
+            failed += ok ? 0 : 1;
+
+            std::printf("[%s] %s, %zu threads\n", ok ? " OK " : "FAIL", g.name, worker_count + 1);
+
+            if (!ok) {
+                std::printf("       state 0x%016" PRIx64 " (golden 0x%016" PRIx64 "), frame 0x%016" PRIx64 " (golden 0x%016" PRIx64 ")\n",
+                            state, g.state_hash, frame, g.frame_hash);
+            }
+        }
+
+        if (print) {
+            std::printf("    {\"%s\", %d, %d, %d, %zu, %u, %d, %u, \"%s\", 0x%016" PRIx64 "ull, 0x%016" PRIx64 "ull},\n",
+                        g.name, g.width, g.height, g.grid_divisor, g.particle_count, g.seed, g.frames, g.lifetime, g.emitter, first_state, first_frame);
+        }
+    }
+
+    if (!print) {
+        std::printf("\n%d golden checks failed\n", failed);
+    }
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
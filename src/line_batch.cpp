@@ -0,0 +1,89 @@
+#include "line_batch.hpp"
+
+// std
+#include <cmath>
+
+line_batch::line_batch(SDL_Renderer *sdl_renderer, std::size_t segment_capacity) noexcept(false)
+:   sdl_renderer{sdl_renderer}
+,   vertices(segment_capacity * 4)
+,   indices(segment_capacity * 6)
+,   segment_capacity{segment_capacity}
+,   segment_count{0}
+,   colour{0, 0, 0, 255} {
+
+    // the index pattern never changes so build it once up front
+    for (std::size_t i = 0; i < segment_capacity; i++) {
+        int base = static_cast<int>(i * 4);
+        int *quad = &indices[i * 6];
+
+        quad[0] = base + 0;
+        quad[1] = base + 1;
+        quad[2] = base + 2;
+        quad[3] = base + 2;
+        quad[4] = base + 1;
+        quad[5] = base + 3;
+    }
+}
+
+void line_batch::begin(Uint8 r, Uint8 g, Uint8 b, Uint8 a) noexcept {
+    flush();
+    colour = SDL_Color{r, g, b, a};
+}
+
+void line_batch::push(float x1, float y1, float x2, float y2) noexcept {
+    if (segment_capacity == 0) {
+        return;
+    }
+
+    if (segment_count == segment_capacity) {
+        flush();
+    }
+
+    // half pixel offset perpendicular to the segment gives a one pixel wide quad
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+    float length = std::sqrt(dx * dx + dy * dy);
+    float nx = 0.0f;
+    float ny = 0.5f;
+    float tx = 0.0f; // how far each end is pushed out along the segment
+
+    if (length > 0.0f) {
+        nx = -dy / length * 0.5f;
+        ny =  dx / length * 0.5f;
+    } else {
+        // the end points are the same (a particle that did not move) - a one pixel square
+        // where SDL_RenderDrawLine would draw a point, rather than a quad with no area
+        tx = 0.5f;
+    }
+
+    SDL_Vertex *quad = &vertices[segment_count * 4];
+    quad[0] = SDL_Vertex{SDL_FPoint{x1 - tx + nx, y1 + ny}, colour, SDL_FPoint{0.0f, 0.0f}};
+    quad[1] = SDL_Vertex{SDL_FPoint{x1 - tx - nx, y1 - ny}, colour, SDL_FPoint{0.0f, 0.0f}};
+    quad[2] = SDL_Vertex{SDL_FPoint{x2 + tx + nx, y2 + ny}, colour, SDL_FPoint{0.0f, 0.0f}};
+    quad[3] = SDL_Vertex{SDL_FPoint{x2 + tx - nx, y2 - ny}, colour, SDL_FPoint{0.0f, 0.0f}};
+
+    segment_count++;
+}
+
+void line_batch::flush() noexcept {
+    if (segment_count == 0) {
+        return;
+    }
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    SDL_RenderGeometry(sdl_renderer, nullptr, vertices.data(), static_cast<int>(segment_count * 4), indices.data(), static_cast<int>(segment_count * 6));
+#else
+    SDL_SetRenderDrawColor(sdl_renderer, colour.r, colour.g, colour.b, colour.a);
+
+    for (std::size_t i = 0; i < segment_count; i++) {
+        SDL_Vertex const *quad = &vertices[i * 4];
+        
+        // the segment end points are the midpoints of each quad edge
+        SDL_RenderDrawLineF(sdl_renderer,
+            (quad[0].position.x + quad[1].position.x) * 0.5f, (quad[0].position.y + quad[1].position.y) * 0.5f,
+            (quad[2].position.x + quad[3].position.x) * 0.5f, (quad[2].position.y + quad[3].position.y) * 0.5f);
+    }
+#endif
+
+    segment_count = 0;
+}
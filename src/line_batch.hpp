@@ -0,0 +1,40 @@
+#ifndef line_batch_hpp
+#define line_batch_hpp
+
+// std
+#include <vector>
+#include <cstddef>
+
+// dependancies
+#include "SDL2/SDL.h"
+
+/* collects line segments into a preallocated vertex buffer and submits them to
+ the renderer in one call instead of one SDL_RenderDrawLine per segment.
+ 
+ each segment is expanded into a one pixel wide quad (4 vertices, 6 indices) - a one
+ pixel square when both ends are the same point - and drawn with SDL_RenderGeometry,
+ so the draw colour (and alpha) is baked into the vertices and the renderer blend
+ mode still applies. the buffers are sized once
+ and reused every frame - if a frame pushes more segments than the capacity the
+ batch flushes early rather than growing.
+
+ on SDL versions older than 2.0.18 (no SDL_RenderGeometry) flush falls back to
+ SDL_RenderDrawLineF per segment, so the batch is still correct, just not faster.
+*/
+
+struct line_batch {
+    SDL_Renderer *sdl_renderer;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+    std::size_t segment_capacity;
+    std::size_t segment_count;
+    SDL_Color colour;
+
+    line_batch(SDL_Renderer *sdl_renderer, std::size_t segment_capacity) noexcept(false);
+
+    void begin(Uint8 r, Uint8 g, Uint8 b, Uint8 a) noexcept;
+    void push(float x1, float y1, float x2, float y2) noexcept;
+    void flush() noexcept;
+};
+
+#endif // line_batch_hpp
@@ -6,11 +6,28 @@
 #include <cstdint>
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 
 // my
 #include "djc_math/djc_math.hpp"
 #include "sdl_module.hpp"
 #include "particle.hpp"
+#include "simulation.hpp"
+#include "options.hpp"
+#include "profiler.hpp"
+#include "tracer.hpp"
+#include "perf_counters.hpp"
+#include "thread_pool.hpp"
+#include "render_passes.hpp"
+#include "fixed_timestep.hpp"
+#include "sim_pipeline.hpp"
+#include "flow_field_generator.hpp"
+#include "frame_capture.hpp"
+#include "snapshot.hpp"
+#include "trajectory.hpp"
+#include "field_sequence.hpp"
+#include "chunked_field.hpp"
+#include "quality_controller.hpp"
 
 // dependancies
 #include "SDL2/SDL.h"
@@ -18,37 +35,187 @@
 int main(int argc, char *argv[]) {
 
     using namespace std::chrono_literals;
+
+    app_options options;
+
+    if (parse_options(argc, argv, options) < 0) {
+        return EXIT_FAILURE;
+    }
+
+    // stdout carries the video stream, everything that is normally printed goes to stderr
+    if (options.capture_path && std::strcmp(options.capture_path, "-") == 0) {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
+    // headless runs only need the event queue, there is no display to talk to
+    Uint32 sdl_subsystems = options.headless ? SDL_INIT_EVENTS | SDL_INIT_TIMER : SDL_INIT_EVERYTHING;
     
-    if (SDL_Init(SDL_INIT_EVERYTHING)) {
+    if (SDL_Init(sdl_subsystems)) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL Could not be initialised: %s", SDL_GetError());
         SDL_Quit();
         return EXIT_FAILURE;
     }
     
     window_spec main_window{640, 460, 30};
+    main_window.headless = options.headless;
 
     if (main_window.init() < 0) {
         SDL_Quit();     
         return EXIT_FAILURE; 
     }
            
-    djc::math::perlin<double> noisy(227);
-    std::vector<std::uint32_t> perlin_pixel_buffer(main_window.perlin_grid_width * main_window.perlin_grid_height, 0);
-    std::vector<djc::math::vec2f> perlin_flow_field(main_window.perlin_grid_width * main_window.perlin_grid_height, djc::math::vec2f(0, 0));
-    std::vector<particle> particles(10000, djc::math::vec2f(0,0));
-       
-    // give the particles random initial positions
-    for (particle & p : particles) {
-        p = djc::math::vec2f(std::rand() % main_window.renderer_width, std::rand() % main_window.renderer_height);
+    // a captured frame is one step, so the video plays at sim_hz - as in headless runs
+    bool step_per_frame = options.headless || options.capture_path;
+
+    // pipelined - the simulation thread and the render thread each get half of the workers.
+    // perf counters follow the main thread only and a bake needs every step, so they step
+    // the simulation there
+    bool pipelined = !options.serial && !step_per_frame && options.sim_hz > 0 && !options.perf_counters && !options.bake_fields_path;
+    std::size_t sim_worker_count = pipelined ? thread_pool::default_worker_count() / 2 : 0;
+
+    simulation sim(main_window.renderer_width, main_window.renderer_height, main_window.perlin_grid_divisor, 10000);
+    thread_pool workers(thread_pool::default_worker_count() - sim_worker_count);
+    thread_pool sim_workers(sim_worker_count);
+
+    // before anything below takes its sizes or its zstep from the simulation
+    if (options.load_snapshot_path && load_snapshot(sim, options.load_snapshot_path, &workers) < 0) {
+        SDL_Quit();
+        return EXIT_FAILURE;
+    }
+
+    field_sequence_reader field_playback;
+
+    if (options.play_fields_path) {
+        if (field_playback.open(options.play_fields_path) < 0) {
+            SDL_Quit();
+            return EXIT_FAILURE;
+        }
+
+        if (field_playback.grid_width() != sim.grid_width || field_playback.grid_height() != sim.grid_height) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "\"%s\" was baked on a %d x %d grid, this one is %d x %d", options.play_fields_path,
+                         field_playback.grid_width(), field_playback.grid_height(), sim.grid_width, sim.grid_height);
+            SDL_Quit();
+            return EXIT_FAILURE;
+        }
+
+        sim.playback = &field_playback;
+    }
+
+    chunked_field world(sim.noisy, sim.grid_width, sim.grid_height, static_cast<std::size_t>(options.world_cache_mb) << 20);
+
+    if (options.world) {
+        if (sim.playback) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "--world can not play back a baked field sequence");
+            SDL_Quit();
+            return EXIT_FAILURE;
+        }
+
+        sim.world = &world;
+    }
+
+    // a particle born again takes over the slot of one that died, it would carry on in
+    // the dead one's trajectory column
+    if (options.lifetime > 0 && options.trajectory_path) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "--lifetime can not be recorded with --trajectory, particles have to keep their columns");
+        SDL_Quit();
+        return EXIT_FAILURE;
+    }
+
+    sim.lifetime = static_cast<std::uint32_t>(options.lifetime);
+
+    if ((options.emit_image_path && sim.emitter.load_image(options.emit_image_path) < 0)
+        || (options.emitter && sim.emitter.set_kind(options.emitter) < 0)) {
+        SDL_Quit();
+        return EXIT_FAILURE;
     }
 
+    render_passes passes(main_window, workers, sim, options.software_ghost);
+    passes.lod_spacing = static_cast<float>(options.flow_lod_spacing);
+    flow_field_generator field_generator(sim);
+    sim_pipeline pipeline(sim, sim_workers, fixed_timestep(options.sim_hz, options.max_substeps));
+    frame_capture capture;
+
+    if (options.capture_path) {
+        if (capture.open(options.capture_path, options.capture_format, main_window.renderer_width, main_window.renderer_height, options.sim_hz) < 0) {
+            SDL_Quit();
+            return EXIT_FAILURE;
+        }
+
+        passes.capture = &capture;
+    }
+
+    field_sequence_writer field_bake;
+
+    if (options.bake_fields_path) {
+        if (field_bake.open(options.bake_fields_path, options.bake_format, sim.grid_width, sim.grid_height) < 0) {
+            SDL_Quit();
+            return EXIT_FAILURE;
+        }
+    }
+
+    trajectory_recorder trajectory;
+    std::uint64_t recorded_steps = 0;
+
+    if (options.trajectory_path) {
+        if (trajectory.open(options.trajectory_path, options.trajectory_format, sim.width, sim.height, sim.particles.size(),
+                            options.trajectory_every, options.trajectory_stride) < 0) {
+            SDL_Quit();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // --target-fps - the quality follows the frame time, inside the bounds. a knob that sizes
+    // a file or a stream (the trajectory's particles, a baked or played back grid) is locked,
+    // as is the grid of a world. it never goes below one particle, 0 is no change to the pipeline
+    bool adaptive = options.target_fps > 0;
+    std::size_t start_particles = sim.particles.size();
+    quality_bounds bounds{
+        std::max<std::size_t>(1, std::min(static_cast<std::size_t>(options.min_particles), start_particles)),
+        std::max(static_cast<std::size_t>(options.max_particles), start_particles),
+        sim.grid_divisor,
+        options.max_grid_divisor > 0 ? std::max(options.max_grid_divisor, sim.grid_divisor) : sim.grid_divisor * 2,
+        std::max(1, options.max_ghost_stride)
+    };
+
+    if (trajectory.is_open()) {
+        bounds.min_particles = start_particles;
+        bounds.max_particles = start_particles;
+    }
+
+    if (sim.world || sim.playback || field_bake.is_open()) {
+        bounds.max_grid_divisor = sim.grid_divisor;
+    }
+
+    bounds.max_grid_divisor = std::max(sim.grid_divisor, std::min(bounds.max_grid_divisor, std::min(sim.width, sim.height)));
+    quality_controller quality(1000.0 / std::max(1, options.target_fps), bounds, quality_settings{start_particles, sim.grid_divisor, 1}, pipelined);
+
     SDL_Event event;
     int current_frame_buffer = 0; // keeps track of the frame buffer to draw
-    double acc = 0.0;
-    double zstep = 0.0;
     bool running = true;
     auto start = std::chrono::system_clock::now();
     int frames = 0;
+    int total_frames = 0;
+    frame_profiler profiler;
+    auto profile_start = std::chrono::steady_clock::now();
+    fixed_timestep timestep(options.sim_hz, options.max_substeps);
+    auto frame_start = std::chrono::steady_clock::now();
+
+    profiler_enable(options.profile || adaptive);
+    tracer_enable(options.trace_path != nullptr);
+
+    if (options.perf_counters) {
+        perf_counters_open(); // carries on without counters if they are not permitted
+    }
+
+    // pipelined - the noise moves off the simulation thread as well, unless it is played back
+    if (pipelined) {
+        if (!sim.playback && !sim.world) {
+            sim.generator = &field_generator;
+            field_generator.start();
+        }
+
+        pipeline.start();
+    }
 
     while (running) {
         auto now = std::chrono::system_clock::now();
@@ -60,150 +227,187 @@ int main(int argc, char *argv[]) {
             frames = 0;
         } 
 
-        // check for input events 
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) {
-                // "x" in the window was pressed, brake out of this while loop
-                SDL_Log("SDL_QUIT");
-                running = false;
-                break; 
+        if (options.profile || adaptive) {
+            profiler.collect();
+        }
+
+        if (options.profile) {
+            if (options.profile_interval > 0 && std::chrono::steady_clock::now() - profile_start >= std::chrono::seconds(options.profile_interval)) {
+                profiler.report(std::cout);
+                perf_counters_report(std::cout);
+                profile_start = std::chrono::steady_clock::now();
             }
+        }
 
-            if (event.type == SDL_KEYUP) {
-                if (event.key.keysym.sym == SDLK_SPACE) {
-                    // if "space" key is pressed cycle to to next frame buffer
-                    current_frame_buffer += 1;
-                    
-                    if (current_frame_buffer == 3) {
-                        current_frame_buffer = 0;
-                    }
-                }            
-
-                if (event.key.keysym.sym == SDLK_c) {
-                    // if the current buffer is the gost buffer and "c" key is pressed - clear it 
-                    if (current_frame_buffer == 2) { 
-                        SDL_SetRenderTarget(main_window.sdl_renderer, main_window.sdl_gost_texture);
-                        SDL_SetRenderDrawColor(main_window.sdl_renderer, 255, 255, 255, 255);
-                        SDL_RenderClear(main_window.sdl_renderer);
+        // between frames the simulation is ours in serial runs, the pipeline hands it over otherwise
+        if (adaptive) {
+            if (quality.update(profiler)) {
+                quality_settings const & q = quality.settings();
+                passes.ghost_stride = q.ghost_stride;
+
+                if (pipelined) {
+                    pipeline.resize_particles(q.particles);
+                    pipeline.regrid(q.grid_divisor);
+                } else {
+                    sim.resize_particles(q.particles);
+
+                    if (q.grid_divisor != sim.grid_divisor) {
+                        sim.regrid(q.grid_divisor, &workers);
                     }
                 }
+
+                SDL_Log("quality: %zu particles, grid divisor %d, trails for 1 particle in %d", q.particles, q.grid_divisor, q.ghost_stride);
+            }
+
+            // only the controller reads them without --profile
+            if (!options.profile) {
+                profiler.reset();
             }
         }
 
-        // update all the particles
-        for (particle & p : particles) {
-
-            // make sure particles do screen wrapping
-            if (p.current_position.x < 0) p.current_position.x = main_window.renderer_width;
-            if (p.current_position.x > main_window.renderer_width) p.current_position.x = 0;
-            if (p.current_position.y < 0) p.current_position.y = main_window.renderer_height;
-            if (p.current_position.y > main_window.renderer_height) p.current_position.y = 0;
-            
-            // get the particle position in the perlin grid
-            int grid_x = static_cast<int>(std::floor(p.current_position.x / main_window.perlin_grid_width)); 
-            int grid_y = static_cast<int>(std::floor(p.current_position.y / main_window.perlin_grid_height));
-            int index  = grid_y * main_window.perlin_grid_width + grid_x;  
-            
-            // update the particle using the perlin grid 
-            p.last_position = p.current_position;
-            p.acceleration += perlin_flow_field[index] * 0.01f; 
-            p.velocity += p.acceleration;
-            p.velocity = djc::math::limit(p.velocity, 4.0f);
-            p.current_position += p.velocity;
-            p.acceleration *= 0.0f; // reset 
-        }        
-
-        // begin render -- clear the screen to white
-        //---------------------------------------------------------------------
-        SDL_SetRenderDrawColor(main_window.sdl_renderer, 255, 255, 255, 255);
-        SDL_RenderClear(main_window.sdl_renderer);
-
-        // draw perlin background into texture
-        for (int y = 0; y < main_window.perlin_grid_height; y++) {
-            for (int x = 0; x < main_window.perlin_grid_width; x++) {
-                double X = (double)x / (double)main_window.perlin_grid_width;
-                double Y = (double)y / (double)main_window.perlin_grid_height;
-              
-                float angle = noisy.noise(X * 5 ,Y * 5 , zstep); 
-                std::uint8_t noise = angle * 255; 
-                int index = main_window.perlin_grid_width * y + x;
-                
-                perlin_pixel_buffer[index] = (255 << 24) + (noise << 16) + (noise << 8) + noise; 
-
-                perlin_flow_field[index] = djc::math::vec2f(std::cos(angle * djc::math::tau<float>), std::sin(angle * djc::math::tau<float>)) * 20.0f;
+        stage_timer frame_timer(frame_stage::frame);
+
+        // check for input events 
+        {
+            stage_timer timer(frame_stage::input);
+
+            while (SDL_PollEvent(&event)) {
+                if (event.type == SDL_QUIT) {
+                    // "x" in the window was pressed, brake out of this while loop
+                    SDL_Log("SDL_QUIT");
+                    running = false;
+                    break; 
+                }
+
+                // arrow keys scroll the world a cell at a time, held down they repeat
+                if (event.type == SDL_KEYDOWN && sim.world) {
+                    int x = event.key.keysym.sym == SDLK_RIGHT ? 1 : event.key.keysym.sym == SDLK_LEFT ? -1 : 0;
+                    int y = event.key.keysym.sym == SDLK_DOWN ? 1 : event.key.keysym.sym == SDLK_UP ? -1 : 0;
+
+                    if (pipelined) {
+                        pipeline.pan(x, y);
+                    } else {
+                        sim.pan(x, y);
+                    }
+                }
+
+                // the mouse wheel zooms on the cursor, dragging pans - mouse positions are in window
+                // points, the camera works in renderer pixels
+                float points_to_pixels = (float)main_window.renderer_width / (float)main_window.dpi_scaled_width;
+
+                if (event.type == SDL_MOUSEWHEEL) {
+                    int mouse_x = 0;
+                    int mouse_y = 0;
+                    SDL_GetMouseState(&mouse_x, &mouse_y);
+                    passes.camera.zoom_at(std::pow(1.25f, static_cast<float>(event.wheel.y)), mouse_x * points_to_pixels, mouse_y * points_to_pixels);
+                }
+
+                if (event.type == SDL_MOUSEMOTION && (event.motion.state & SDL_BUTTON_LMASK)) {
+                    passes.camera.pan(event.motion.xrel * points_to_pixels, event.motion.yrel * points_to_pixels);
+                }
+
+                if (event.type == SDL_KEYUP) {
+                    if (event.key.keysym.sym == SDLK_r) {
+                        passes.camera.reset();
+                    }
+
+                    if (event.key.keysym.sym == SDLK_SPACE) {
+                        // if "space" key is pressed cycle to to next frame buffer
+                        current_frame_buffer += 1;
+                    
+                        if (current_frame_buffer == 3) {
+                            current_frame_buffer = 0;
+                        }
+                    }            
+
+                    if (event.key.keysym.sym == SDLK_c) {
+                        // if the current buffer is the gost buffer and "c" key is pressed - clear it 
+                        if (current_frame_buffer == 2) { 
+                            passes.clear_ghost();
+                        }
+                    }
+                }
             }
         }
-        SDL_UpdateTexture(main_window.sdl_perlin_texture, NULL, perlin_pixel_buffer.data(), sizeof(std::uint32_t) * main_window.perlin_grid_width); 
-        
-        // draw flow field into texture
+
+        // step the simulation as many fixed steps as the last frame took (one when headless or capturing),
+        // or pick up the latest step from the simulation thread
         //---------------------------------------------------------------------
-        SDL_SetRenderTarget(main_window.sdl_renderer, main_window.sdl_flow_field_texture);
-        SDL_RenderClear(main_window.sdl_renderer);
-        SDL_SetRenderDrawColor(main_window.sdl_renderer, 0, 0, 0, 255);
-
-        float xstep = (float)main_window.renderer_width / (float)main_window.perlin_grid_width; 
-        float ystep = (float)main_window.renderer_height / (float)main_window.perlin_grid_height; 
-        float x_pos = 0.0f;
-        float y_pos = 0.0f;
-
-        for (int y = 0; y < main_window.perlin_grid_height; y++) {
-            for (int x = 0; x < main_window.perlin_grid_width; x++) {
-               // render perlin flow lines
-               int index = y * main_window.perlin_grid_width + x;
-
-               int x1 = x_pos - xstep / 2;
-               int y1 = y_pos - ystep / 2;
-               int x2 = x1 + perlin_flow_field[index].x;
-               int y2 = y1 + perlin_flow_field[index].y;
-                
-               SDL_RenderDrawLine(main_window.sdl_renderer, x1, y1, x2, y2); 
-               x_pos += xstep; 
+        sim_view view;
+        float alpha;
+
+        if (pipelined) {
+            view = pipeline.acquire();
+            alpha = pipeline.alpha();
+        } else {
+            auto frame_now = std::chrono::steady_clock::now();
+            double frame_seconds = step_per_frame ? timestep.step_seconds : std::chrono::duration<double>(frame_now - frame_start).count();
+            frame_start = frame_now;
+
+            for (int steps = timestep.advance(frame_seconds); steps > 0; steps--) {
+                sim.tick(&workers);
+
+                // the field the step just filled is the one the next step moves on
+                if (field_bake.is_open() && field_bake.append(sim.flow_field.data(), sim.shades.data(), sim.steps - 1) < 0) {
+                    running = false;
+                    break;
+                }
             }
 
-            x_pos = 0.0f;
-            y_pos += ystep;
+            view = sim.view();
+            alpha = timestep.alpha();
         }
-        //..
-  
 
-        // draw flow field affected effect 
-        //---------------------------------------------------------------------
-        SDL_SetRenderTarget(main_window.sdl_renderer, main_window.sdl_gost_texture);
-        SDL_SetRenderDrawColor(main_window.sdl_renderer, 0, 0, 0, 10);
-        SDL_SetRenderDrawBlendMode(main_window.sdl_renderer, SDL_BLENDMODE_BLEND);
-        
-        for(particle & p: particles) {
-            SDL_RenderDrawLine(main_window.sdl_renderer, p.last_position.x, p.last_position.y, p.current_position.x, p.current_position.y);
+        if (trajectory.is_open() && view.steps != recorded_steps) {
+            trajectory.record(view, &workers);
+            recorded_steps = view.steps;
         }
 
-        // end render
+        // render
         //---------------------------------------------------------------------
-        {
-            SDL_SetRenderTarget(main_window.sdl_renderer, NULL);
-                  
-            // perlin background animation - copy into back buffer
-            if (current_frame_buffer == 0) {
-                SDL_RenderCopy(main_window.sdl_renderer, main_window.sdl_perlin_texture, NULL, NULL);
-            }
-            
-            // flow field lines - copy into backbuffer 
-            if (current_frame_buffer == 1) {
-                SDL_RenderCopy(main_window.sdl_renderer, main_window.sdl_flow_field_texture, NULL, NULL);
-            }
-            
-            // gosting line effect - copy into back buffer 
-            if (current_frame_buffer == 2) {
-                SDL_RenderCopy(main_window.sdl_renderer, main_window.sdl_gost_texture, NULL, NULL);
-            }
-            
-            SDL_RenderPresent(main_window.sdl_renderer); // swap back bufer to front
-        }
+        passes.begin_frame();
+        passes.draw_perlin(view);
+        passes.draw_flow_lines(view);
+        passes.draw_ghost(view, alpha);
+        passes.present(current_frame_buffer);
         
         // step the accumilators 
         //---------------------------------------------------------------------
-        zstep+= 0.005f;
-        acc += .005;
+        perf_counters_end_frame();
         frames++;
+        total_frames++;
+
+        if (options.frame_limit > 0 && total_frames >= options.frame_limit) {
+            running = false;
+        }
+
+        // the capture consumer went away, or the disk filled up under the capture or the trajectory
+        if (capture.failed() || trajectory.failed()) {
+            running = false;
+        }
+    }
+
+    pipeline.stop();
+    field_generator.stop();
+    capture.close();
+    trajectory.close();
+    field_bake.close();
+
+    // the simulation thread has stopped, so the simulation is ours again
+    if (options.save_snapshot_path) {
+        save_snapshot(sim, options.save_snapshot_path, &workers);
+    }
+
+    if (options.profile) {
+        profiler.collect();
+        profiler.report(std::cout);
+        perf_counters_report(std::cout);
+        perf_counters_close();
+    }
+
+    if (options.trace_path) {
+        tracer_enable(false);
+        tracer_write(options.trace_path);
     }
 
     SDL_Quit();
@@ -0,0 +1,193 @@
+#include "options.hpp"
+
+// std
+#include <cstring>
+#include <cstdlib>
+
+// dependancies
+#include "SDL2/SDL.h"
+
+app_options::app_options() noexcept
+:   software_ghost{false}
+,   headless{false}
+,   frame_limit{0}
+,   profile{false}
+,   profile_interval{0}
+,   perf_counters{false}
+,   trace_path{nullptr}
+,   sim_hz{60}
+,   max_substeps{4}
+,   serial{false}
+,   capture_path{nullptr}
+,   capture_format{nullptr}
+,   trajectory_path{nullptr}
+,   trajectory_format{nullptr}
+,   trajectory_every{1}
+,   trajectory_stride{1}
+,   bake_fields_path{nullptr}
+,   bake_format{nullptr}
+,   play_fields_path{nullptr}
+,   world{false}
+,   world_cache_mb{8}
+,   flow_lod_spacing{0}
+,   target_fps{0}
+,   min_particles{1000}
+,   max_particles{0}
+,   max_grid_divisor{0}
+,   max_ghost_stride{8}
+,   lifetime{0}
+,   emitter{nullptr}
+,   emit_image_path{nullptr}
+,   load_snapshot_path{nullptr}
+,   save_snapshot_path{nullptr} {
+
+}
+
+namespace {
+
+//------------------------------------------------------------
+bool
+read_int(int argc, char *argv[], int & i, int & value) {
+    if (i + 1 >= argc) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects a value", argv[i]);
+        return false;
+    }
+
+    char *end = nullptr;
+    long parsed = std::strtol(argv[++i], &end, 10);
+
+    if (*end != '\0' || parsed < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects a positive number, got \"%s\"", argv[i - 1], argv[i]);
+        return false;
+    }
+
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+} // namespace
+
+int parse_options(int argc, char *argv[], app_options & options) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--software-ghost") == 0) {
+            options.software_ghost = true;
+        } else if (std::strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        } else if (std::strcmp(argv[i], "--frames") == 0) {
+            if (!read_int(argc, argv, i, options.frame_limit)) return -1;
+        } else if (std::strcmp(argv[i], "--profile") == 0) {
+            options.profile = true;
+        } else if (std::strcmp(argv[i], "--profile-interval") == 0) {
+            if (!read_int(argc, argv, i, options.profile_interval)) return -1;
+            options.profile = true;
+        } else if (std::strcmp(argv[i], "--perf-counters") == 0) {
+            options.perf_counters = true;
+            options.profile = true;
+        } else if (std::strcmp(argv[i], "--trace") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects a path", argv[i]);
+                return -1;
+            }
+            options.trace_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--sim-hz") == 0) {
+            if (!read_int(argc, argv, i, options.sim_hz)) return -1;
+        } else if (std::strcmp(argv[i], "--max-substeps") == 0) {
+            if (!read_int(argc, argv, i, options.max_substeps)) return -1;
+        } else if (std::strcmp(argv[i], "--serial") == 0) {
+            options.serial = true;
+        } else if (std::strcmp(argv[i], "--capture") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects a path", argv[i]);
+                return -1;
+            }
+            options.capture_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--capture-format") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects y4m, png, rgba or bgra", argv[i]);
+                return -1;
+            }
+            options.capture_format = argv[++i];
+        } else if (std::strcmp(argv[i], "--trajectory") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects a path", argv[i]);
+                return -1;
+            }
+            options.trajectory_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--trajectory-format") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects float or int16", argv[i]);
+                return -1;
+            }
+            options.trajectory_format = argv[++i];
+        } else if (std::strcmp(argv[i], "--trajectory-every") == 0) {
+            if (!read_int(argc, argv, i, options.trajectory_every)) return -1;
+        } else if (std::strcmp(argv[i], "--trajectory-stride") == 0) {
+            if (!read_int(argc, argv, i, options.trajectory_stride)) return -1;
+        } else if (std::strcmp(argv[i], "--bake-fields") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects a path", argv[i]);
+                return -1;
+            }
+            options.bake_fields_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--bake-format") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects vec2f or angle16", argv[i]);
+                return -1;
+            }
+            options.bake_format = argv[++i];
+        } else if (std::strcmp(argv[i], "--play-fields") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects a path", argv[i]);
+                return -1;
+            }
+            options.play_fields_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--world") == 0) {
+            options.world = true;
+        } else if (std::strcmp(argv[i], "--world-cache-mb") == 0) {
+            if (!read_int(argc, argv, i, options.world_cache_mb)) return -1;
+        } else if (std::strcmp(argv[i], "--flow-lod") == 0) {
+            if (!read_int(argc, argv, i, options.flow_lod_spacing)) return -1;
+        } else if (std::strcmp(argv[i], "--target-fps") == 0) {
+            if (!read_int(argc, argv, i, options.target_fps)) return -1;
+        } else if (std::strcmp(argv[i], "--min-particles") == 0) {
+            if (!read_int(argc, argv, i, options.min_particles)) return -1;
+        } else if (std::strcmp(argv[i], "--max-particles") == 0) {
+            if (!read_int(argc, argv, i, options.max_particles)) return -1;
+        } else if (std::strcmp(argv[i], "--max-grid-divisor") == 0) {
+            if (!read_int(argc, argv, i, options.max_grid_divisor)) return -1;
+        } else if (std::strcmp(argv[i], "--max-ghost-stride") == 0) {
+            if (!read_int(argc, argv, i, options.max_ghost_stride)) return -1;
+        } else if (std::strcmp(argv[i], "--lifetime") == 0) {
+            if (!read_int(argc, argv, i, options.lifetime)) return -1;
+        } else if (std::strcmp(argv[i], "--emitter") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects uniform, edges or image", argv[i]);
+                return -1;
+            }
+            options.emitter = argv[++i];
+        } else if (std::strcmp(argv[i], "--emit-image") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects a path", argv[i]);
+                return -1;
+            }
+            options.emit_image_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--load-snapshot") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects a path", argv[i]);
+                return -1;
+            }
+            options.load_snapshot_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--save-snapshot") == 0) {
+            if (i + 1 >= argc) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s expects a path", argv[i]);
+                return -1;
+            }
+            options.save_snapshot_path = argv[++i];
+        } else {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "unknown option \"%s\"", argv[i]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
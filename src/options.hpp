@@ -0,0 +1,111 @@
+#ifndef options_hpp
+#define options_hpp
+
+/* command line switches
+
+ --software-ghost   draw the ghost trails on the cpu instead of through the renderer
+ --headless         no window or display, render into an off screen surface
+ --frames <n>       stop after n frames (0 = run until the window is closed)
+ --profile          time each frame stage and report percentiles on exit
+ --profile-interval <seconds>
+                    also report every n seconds (implies --profile)
+ --perf-counters    sample cpu performance counters per stage (linux), reported with --profile.
+                    main thread only, implies --serial
+ --trace <path>     write a chrome trace event json timeline to path on exit
+ --sim-hz <n>       simulation steps per second, independent of the frame rate
+                    (default 60, 0 = one step per rendered frame)
+ --max-substeps <n> most simulation steps run in one frame before the backlog is
+                    dropped (default 4)
+
+ --capture <path>   record every frame: .y4m video, .png sequence (frame_%05d.png), .bgra
+                    or raw rgba for any other extension. "-" streams to stdout (y4m by
+                    default), a named pipe works as a path
+ --capture-format <y4m|png|rgba|bgra>
+                    capture format, overrides the one the path's extension says
+ --trajectory <path> record the particle positions of every step to a columnar file
+ --trajectory-format <float|int16>
+                    position encoding (default float)
+ --trajectory-every <n>
+                    keep one step in n (default 1)
+ --trajectory-stride <n>
+                    keep one particle in n (default 1)
+ --bake-fields <path>
+                    write the flow field of every step to a sequence file (implies --serial)
+ --bake-format <vec2f|angle16>
+                    field encoding (default vec2f)
+ --play-fields <path>
+                    read the flow fields from a baked sequence instead of the noise
+ --world            make the field unbounded, the arrow keys scroll through it
+ --world-cache-mb <n>
+                    most memory kept for generated world chunks (default 8)
+ --flow-lod <pixels>
+                    draw the flow lines at least this far apart on screen, averaging
+                    the cells in between (default 0, one line per cell)
+ --target-fps <n>   hold n frames per second by adjusting the particle count, grid
+                    divisor and ghost trail density (default 0, fixed quality)
+ --min-particles <n>
+                    fewest particles --target-fps may go down to (default 1000, at least 1)
+ --max-particles <n>
+                    most particles --target-fps may go up to (default the starting count)
+ --max-grid-divisor <n>
+                    coarsest grid --target-fps may go to (default twice the starting one)
+ --max-ghost-stride <n>
+                    fewest trails --target-fps may draw, one particle in n (default 8)
+ --lifetime <n>     particles live for about n steps, then are born again (default 0,
+                    they live forever). not with --trajectory
+ --emitter <uniform|edges|image>
+                    where particles are born again (default uniform)
+ --emit-image <path>
+                    binary pgm the image emitter weights births by, implies --emitter image
+ --serial           step the simulation on the main thread between frames instead of
+                    on its own thread alongside rendering
+
+ --load-snapshot <path>
+                    start from a checkpoint instead of a fresh simulation
+ --save-snapshot <path>
+                    checkpoint the simulation to path on exit
+
+ headless runs have no display to keep time with, so they run exactly one step
+ per frame on the main thread, as does --sim-hz 0.
+*/
+
+struct app_options {
+    bool software_ghost;
+    bool headless;
+    int frame_limit;
+    bool profile;
+    int profile_interval;
+    bool perf_counters;
+    char const *trace_path; // null when not tracing
+    int sim_hz;
+    int max_substeps;
+    bool serial;
+    char const *capture_path; // null when not capturing
+    char const *capture_format; // null to go by the capture path
+    char const *trajectory_path; // null when not recording
+    char const *trajectory_format; // null for float
+    int trajectory_every;
+    int trajectory_stride;
+    char const *bake_fields_path; // null when not baking
+    char const *bake_format; // null for vec2f
+    char const *play_fields_path; // null to compute the noise
+    bool world;
+    int world_cache_mb;
+    int flow_lod_spacing;
+    int target_fps;
+    int min_particles;
+    int max_particles; // 0 for the starting count
+    int max_grid_divisor; // 0 for twice the starting divisor
+    int max_ghost_stride;
+    int lifetime;
+    char const *emitter; // null for uniform
+    char const *emit_image_path; // null without an image
+    char const *load_snapshot_path; // null for a fresh simulation
+    char const *save_snapshot_path; // null when not saving
+
+    app_options() noexcept;
+};
+
+int parse_options(int argc, char *argv[], app_options & options);
+
+#endif // options_hpp
@@ -1,6 +1,9 @@
 #ifndef particle_hpp
 #define particle_hpp
 
+// std
+#include <cstdint>
+
 // my 
 #include "djc_math/djc_math.hpp"
 
@@ -13,6 +16,8 @@ struct particle {
     djc::math::vec2f last_position;
     djc::math::vec2f velocity;
     djc::math::vec2f acceleration;
+    std::uint32_t age;      // steps since it was born
+    std::uint32_t lifetime; // steps it lives for, 0 until the simulation gives it one
 };
 
 #endif // particle_hpp
@@ -0,0 +1,204 @@
+#include "perf_counters.hpp"
+#include "profiler.hpp"
+
+// std
+#include <iomanip>
+#include <ostream>
+#include <thread>
+
+// dependancies
+#include "SDL2/SDL.h"
+
+#if defined(__linux__)
+#   include <linux/perf_event.h>
+#   include <sys/ioctl.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#   include <cerrno>
+#   include <cstring>
+#endif
+
+namespace {
+
+constexpr std::size_t counter_count = static_cast<std::size_t>(perf_counter::count);
+constexpr std::size_t stage_count = static_cast<std::size_t>(frame_stage::count);
+
+//------------------------------------------------------------
+char const *
+perf_counter_name(std::size_t counter) {
+    switch (static_cast<perf_counter>(counter)) {
+        case perf_counter::cycles:        return "cycles";
+        case perf_counter::instructions:  return "instructions";
+        case perf_counter::l1d_misses:    return "L1D misses";
+        case perf_counter::llc_misses:    return "LLC misses";
+        case perf_counter::branch_misses: return "branch misses";
+        case perf_counter::count:         break;
+    }
+    return "unknown";
+}
+
+struct counter_group {
+    int leader_fd = -1;
+    std::array<int, counter_count> fds{-1, -1, -1, -1, -1};
+    std::array<int, counter_count> slot{-1, -1, -1, -1, -1}; // position in the group read, -1 when not open
+    int open_count = 0;
+    std::thread::id owner;
+};
+
+counter_group g_group;
+
+// totals per stage since the last report, plus how many frames that covers
+std::array<std::array<std::uint64_t, counter_count>, stage_count> g_totals{};
+std::uint64_t g_frames = 0;
+
+#if defined(__linux__)
+//------------------------------------------------------------
+int
+open_counter(std::uint32_t type, std::uint64_t config, int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1; // user space only, allowed at perf_event_paranoid 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+#endif
+
+} // namespace
+
+int perf_counters_open() {
+#if defined(__linux__)
+    perf_counters_close();
+
+    constexpr std::uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    std::uint32_t const types[counter_count] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+    std::uint64_t const configs[counter_count] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, l1d_read_miss, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    for (std::size_t i = 0; i < counter_count; i++) {
+        int fd = open_counter(types[i], configs[i], g_group.leader_fd);
+
+        if (fd < 0) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "perf counter \"%s\" unavailable: %s", perf_counter_name(i), std::strerror(errno));
+            continue;
+        }
+
+        // the first counter that opens leads the group, the rest are read along with it
+        if (g_group.leader_fd < 0) {
+            g_group.leader_fd = fd;
+        }
+
+        g_group.fds[i] = fd;
+        g_group.slot[i] = g_group.open_count++;
+    }
+
+    if (g_group.open_count == 0) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "no perf counters available, check /proc/sys/kernel/perf_event_paranoid");
+        return -1;
+    }
+
+    g_group.owner = std::this_thread::get_id();
+    ioctl(g_group.leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(g_group.leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return 0;
+#else
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "perf counters are only supported on linux");
+    return -1;
+#endif
+}
+
+void perf_counters_close() noexcept {
+#if defined(__linux__)
+    for (std::size_t i = 0; i < counter_count; i++) {
+        if (g_group.fds[i] >= 0 && g_group.fds[i] != g_group.leader_fd) {
+            close(g_group.fds[i]);
+        }
+    }
+
+    if (g_group.leader_fd >= 0) {
+        close(g_group.leader_fd);
+    }
+#endif
+    g_group = counter_group{};
+}
+
+bool perf_counters_enabled() noexcept {
+    return g_group.open_count > 0 && std::this_thread::get_id() == g_group.owner;
+}
+
+bool perf_counters_read(perf_sample & sample) noexcept {
+#if defined(__linux__)
+    // PERF_FORMAT_GROUP layout: { u64 nr; u64 values[nr]; }
+    std::uint64_t buffer[1 + counter_count];
+
+    if (read(g_group.leader_fd, buffer, sizeof(buffer)) < static_cast<ssize_t>(sizeof(std::uint64_t) * (1 + g_group.open_count))) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < counter_count; i++) {
+        sample.values[i] = g_group.slot[i] >= 0 ? buffer[1 + g_group.slot[i]] : 0;
+    }
+    return true;
+#else
+    (void)sample;
+    return false;
+#endif
+}
+
+void perf_counters_record(frame_stage stage, perf_sample const & begin, perf_sample const & end) noexcept {
+    std::array<std::uint64_t, counter_count> & totals = g_totals[static_cast<std::size_t>(stage)];
+
+    for (std::size_t i = 0; i < counter_count; i++) {
+        totals[i] += end.values[i] - begin.values[i];
+    }
+}
+
+void perf_counters_end_frame() noexcept {
+    g_frames++;
+}
+
+void perf_counters_report(std::ostream & out) {
+    if (g_group.open_count == 0 || g_frames == 0) {
+        return;
+    }
+
+    out << "\n------- perf counters (per frame) ------\n";
+    out << std::left << std::setw(16) << "stage" << std::right;
+
+    for (std::size_t i = 0; i < counter_count; i++) {
+        if (g_group.slot[i] >= 0) {
+            out << std::setw(15) << perf_counter_name(i);
+        }
+    }
+
+    out << std::setw(8) << "IPC" << '\n' << std::fixed << std::setprecision(0);
+
+    for (std::size_t stage = 0; stage < stage_count; stage++) {
+        std::array<std::uint64_t, counter_count> const & totals = g_totals[stage];
+        
+        if (totals[static_cast<std::size_t>(perf_counter::cycles)] == 0 && totals[static_cast<std::size_t>(perf_counter::instructions)] == 0) {
+            continue;
+        }
+
+        out << std::left << std::setw(16) << frame_stage_name(static_cast<frame_stage>(stage)) << std::right;
+
+        for (std::size_t i = 0; i < counter_count; i++) {
+            if (g_group.slot[i] >= 0) {
+                out << std::setw(15) << static_cast<double>(totals[i]) / g_frames;
+            }
+        }
+
+        double cycles = static_cast<double>(totals[static_cast<std::size_t>(perf_counter::cycles)]);
+        double instructions = static_cast<double>(totals[static_cast<std::size_t>(perf_counter::instructions)]);
+        out << std::setprecision(2) << std::setw(8) << (cycles > 0 ? instructions / cycles : 0.0) << std::setprecision(0) << '\n';
+    }
+
+    out << std::defaultfloat << std::flush;
+
+    g_totals = {};
+    g_frames = 0;
+}
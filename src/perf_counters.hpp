@@ -0,0 +1,48 @@
+#ifndef perf_counters_hpp
+#define perf_counters_hpp
+
+// std
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <iosfwd>
+
+enum class frame_stage : std::uint8_t; // profiler.hpp
+
+/* hardware performance counters per frame stage (linux perf_event_open).
+
+ cycles, instructions, L1D read misses, LLC misses and branch misses are opened
+ as one counter group on the calling thread, so a stage_timer reads them all with
+ one syscall at the start and end of its scope. counters the kernel or cpu will
+ not give us (perf_event_paranoid, virtual machines, no pmu) are skipped, and if
+ none open at all perf_counters_open() returns -1 and stage timers carry on without them.
+
+ counters only follow the thread that opened them, so only stage timers on that
+ thread are counted (the frame stages in main.cpp), which is why main.cpp steps the
+ simulation on the main thread while they are on. a stage split over the thread pool
+ counts the main thread's share of it (and its wait for the rest) but not the workers'.
+ other platforms always return -1.
+*/
+
+enum class perf_counter : std::uint8_t {
+    cycles,
+    instructions,
+    l1d_misses,
+    llc_misses,
+    branch_misses,
+    count
+};
+
+struct perf_sample {
+    std::array<std::uint64_t, static_cast<std::size_t>(perf_counter::count)> values;
+};
+
+int perf_counters_open();
+void perf_counters_close() noexcept;
+bool perf_counters_enabled() noexcept;
+bool perf_counters_read(perf_sample & sample) noexcept;
+void perf_counters_record(frame_stage stage, perf_sample const & begin, perf_sample const & end) noexcept;
+void perf_counters_end_frame() noexcept;
+void perf_counters_report(std::ostream & out);
+
+#endif // perf_counters_hpp
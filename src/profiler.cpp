@@ -0,0 +1,220 @@
+#include "profiler.hpp"
+#include "tracer.hpp"
+
+// std
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+namespace {
+
+struct stage_sample {
+    std::uint64_t nanoseconds;
+    frame_stage stage;
+};
+
+// single producer (the owning thread), single consumer (frame_profiler::collect)
+struct sample_ring {
+    static constexpr std::size_t capacity = 4096; // power of two
+
+    std::array<stage_sample, capacity> slots;
+    std::atomic<std::size_t> head{0}; // next write, only the owner stores
+    std::atomic<std::size_t> tail{0}; // next read, only the consumer stores
+    std::atomic<std::uint64_t> dropped{0};
+
+    void push(stage_sample sample) noexcept {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        
+        if (h - tail.load(std::memory_order_acquire) == capacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        slots[h & (capacity - 1)] = sample;
+        head.store(h + 1, std::memory_order_release);
+    }
+};
+
+std::atomic<bool> g_enabled{false};
+std::mutex g_rings_mutex;
+std::vector<std::unique_ptr<sample_ring>> g_rings;
+
+//------------------------------------------------------------
+sample_ring &
+thread_ring() {
+    // registered once per thread, the ring outlives the thread so nothing is lost on exit
+    thread_local sample_ring *ring = [] {
+        std::lock_guard<std::mutex> lock(g_rings_mutex);
+        g_rings.push_back(std::make_unique<sample_ring>());
+        return g_rings.back().get();
+    }();
+
+    return *ring;
+}
+
+//------------------------------------------------------------
+double
+percentile_ms(std::vector<std::uint64_t> & sorted, double percentile) {
+    std::size_t index = static_cast<std::size_t>(percentile * (sorted.size() - 1) + 0.5);
+    return sorted[index] / 1.0e6;
+}
+
+} // namespace
+
+char const * frame_stage_name(frame_stage stage) noexcept {
+    switch (stage) {
+        case frame_stage::frame:           return "frame";
+        case frame_stage::input:           return "input";
+        case frame_stage::particle_update: return "particle update";
+        case frame_stage::noise_fill:      return "noise fill";
+        case frame_stage::texture_upload:  return "texture upload";
+        case frame_stage::flow_lines:      return "flow lines";
+        case frame_stage::ghost_draw:      return "ghost draw";
+        case frame_stage::ghost_upload:    return "ghost upload";
+        case frame_stage::present:         return "present";
+        case frame_stage::capture:         return "capture";
+        case frame_stage::count:           break;
+    }
+    return "unknown";
+}
+
+void profiler_enable(bool enable) noexcept {
+    g_enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool profiler_enabled() noexcept {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void profiler_record(frame_stage stage, std::chrono::steady_clock::duration elapsed) noexcept {
+    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    thread_ring().push(stage_sample{static_cast<std::uint64_t>(nanoseconds), stage});
+}
+
+stage_timer::stage_timer(frame_stage stage) noexcept
+:   stage{stage}
+,   active{profiler_enabled() || tracer_enabled()}
+,   counting{perf_counters_enabled()}
+,   start{active ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}}
+,   counters_start{} {
+
+    if (counting) {
+        counting = perf_counters_read(counters_start);
+    }
+}
+
+stage_timer::~stage_timer() {
+    if (counting) {
+        perf_sample counters_end;
+
+        if (perf_counters_read(counters_end)) {
+            perf_counters_record(stage, counters_start, counters_end);
+        }
+    }
+
+    if (!active) {
+        return;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    if (profiler_enabled()) {
+        profiler_record(stage, end - start);
+    }
+
+    if (tracer_enabled()) {
+        tracer_record(frame_stage_name(stage), start, end);
+    }
+}
+
+frame_profiler::frame_profiler() noexcept(false)
+:   samples{}
+,   collected{}
+,   dropped{0} {
+
+    for (std::vector<std::uint64_t> & stage_samples : samples) {
+        stage_samples.reserve(4096);
+    }
+}
+
+void frame_profiler::collect() {
+    std::lock_guard<std::mutex> lock(g_rings_mutex);
+
+    for (std::unique_ptr<sample_ring> & ring : g_rings) {
+        std::size_t t = ring->tail.load(std::memory_order_relaxed);
+        std::size_t h = ring->head.load(std::memory_order_acquire);
+
+        for (; t != h; t++) {
+            stage_sample const & sample = ring->slots[t & (sample_ring::capacity - 1)];
+            samples[static_cast<std::size_t>(sample.stage)].push_back(sample.nanoseconds);
+            collected[static_cast<std::size_t>(sample.stage)]++;
+        }
+
+        ring->tail.store(t, std::memory_order_release);
+        dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+}
+
+std::array<stage_stats, static_cast<std::size_t>(frame_stage::count)> frame_profiler::stats() const {
+    std::array<stage_stats, static_cast<std::size_t>(frame_stage::count)> result{};
+
+    for (std::size_t i = 0; i < samples.size(); i++) {
+        if (samples[i].empty()) {
+            continue;
+        }
+
+        std::vector<std::uint64_t> sorted = samples[i];
+        std::sort(sorted.begin(), sorted.end());
+
+        double total = 0.0;
+        for (std::uint64_t sample : sorted) total += static_cast<double>(sample);
+
+        result[i].samples = sorted.size();
+        result[i].mean_ms = total / sorted.size() / 1.0e6;
+        result[i].p50_ms = percentile_ms(sorted, 0.50);
+        result[i].p95_ms = percentile_ms(sorted, 0.95);
+        result[i].p99_ms = percentile_ms(sorted, 0.99);
+        result[i].max_ms = sorted.back() / 1.0e6;
+    }
+
+    return result;
+}
+
+void frame_profiler::report(std::ostream & out) {
+    auto stage_stats = stats();
+
+    out << "\n------- frame stages (ms) ------\n";
+    out << std::left << std::setw(16) << "stage" << std::right
+        << std::setw(8) << "n" << std::setw(10) << "p50" << std::setw(10) << "p95"
+        << std::setw(10) << "p99" << std::setw(10) << "max" << '\n';
+    out << std::fixed << std::setprecision(3);
+
+    for (std::size_t i = 0; i < stage_stats.size(); i++) {
+        if (stage_stats[i].samples == 0) {
+            continue;
+        }
+
+        out << std::left << std::setw(16) << frame_stage_name(static_cast<frame_stage>(i)) << std::right
+            << std::setw(8) << stage_stats[i].samples
+            << std::setw(10) << stage_stats[i].p50_ms
+            << std::setw(10) << stage_stats[i].p95_ms
+            << std::setw(10) << stage_stats[i].p99_ms
+            << std::setw(10) << stage_stats[i].max_ms << '\n';
+    }
+
+    if (dropped) {
+        out << "dropped samples: " << dropped << '\n';
+    }
+
+    out << std::defaultfloat << std::flush;
+    reset();
+}
+
+void frame_profiler::reset() noexcept {
+    for (std::vector<std::uint64_t> & stage_samples : samples) {
+        stage_samples.clear();
+    }
+    dropped = 0;
+}
@@ -0,0 +1,85 @@
+#ifndef profiler_hpp
+#define profiler_hpp
+
+// std
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+// my
+#include "perf_counters.hpp"
+
+/* per stage frame timing.
+
+ a stage_timer measures its scope with steady_clock and pushes the result into a
+ ring buffer owned by the calling thread (single producer, single consumer - no
+ locks on the hot path). the frame_profiler drains every thread's ring once per
+ frame and reports p50 / p95 / p99 / max per stage for everything collected since
+ the last report.
+
+ timing is off until profiler_enable(true), a disabled stage_timer costs one
+ relaxed atomic load. when the tracer is on each stage_timer also becomes a trace event,
+ and when perf counters are open the stage's counter deltas are accumulated too.
+*/
+
+enum class frame_stage : std::uint8_t {
+    frame,
+    input,
+    particle_update,
+    noise_fill,
+    texture_upload,
+    flow_lines,
+    ghost_draw,
+    ghost_upload,   // the software ghost's pixels to its texture, texture_upload is the perlin's
+    present,
+    capture,
+    count
+};
+
+char const * frame_stage_name(frame_stage stage) noexcept;
+
+void profiler_enable(bool enable) noexcept;
+bool profiler_enabled() noexcept;
+void profiler_record(frame_stage stage, std::chrono::steady_clock::duration elapsed) noexcept;
+
+struct stage_timer {
+    explicit stage_timer(frame_stage stage) noexcept;
+    ~stage_timer();
+
+    stage_timer(stage_timer const &) = delete;
+    stage_timer & operator = (stage_timer const &) = delete;
+
+    frame_stage stage;
+    bool active;
+    bool counting;
+    std::chrono::steady_clock::time_point start;
+    perf_sample counters_start;
+};
+
+struct stage_stats {
+    std::size_t samples;
+    double mean_ms;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    double max_ms;
+};
+
+struct frame_profiler {
+    frame_profiler() noexcept(false);
+
+    void collect();
+    std::array<stage_stats, static_cast<std::size_t>(frame_stage::count)> stats() const;
+    void report(std::ostream & out);
+    void reset() noexcept;
+
+    std::array<std::vector<std::uint64_t>, static_cast<std::size_t>(frame_stage::count)> samples; // nanoseconds
+    std::array<std::uint64_t, static_cast<std::size_t>(frame_stage::count)> collected; // per stage ever, reset() leaves it
+    std::uint64_t dropped;
+};
+
+#endif // profiler_hpp
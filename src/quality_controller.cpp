@@ -0,0 +1,161 @@
+#include "quality_controller.hpp"
+
+// std
+#include <algorithm>
+
+quality_controller::quality_controller(double budget_ms, quality_bounds const & bounds, quality_settings const & start, bool sim_thread) noexcept(false)
+:   m_budget_ms{budget_ms}
+,   m_sim_thread{sim_thread}
+,   m_bounds{bounds}
+,   m_settings{start}
+,   m_seen{}
+,   m_window_ms{}
+,   m_frame_ms{}
+,   m_skip_windows{0}
+,   m_calm_windows{0}
+,   m_upgrade_windows{first_upgrade_windows}
+,   m_just_restored{false} {
+
+    m_frame_ms.reserve(window_frames);
+}
+
+bool quality_controller::update(frame_profiler const & profiler) {
+    std::size_t frame = static_cast<std::size_t>(frame_stage::frame);
+
+    for (std::size_t stage = 0; stage < m_seen.size(); stage++) {
+        // the newest samples, however often the profiler was reset since the last look
+        std::vector<std::uint64_t> const & samples = profiler.samples[stage];
+        std::uint64_t fresh = profiler.collected[stage] - m_seen[stage];
+        std::size_t first = fresh < samples.size() ? samples.size() - static_cast<std::size_t>(fresh) : 0;
+
+        for (std::size_t i = first; i < samples.size(); i++) {
+            double ms = samples[i] * 1e-6;
+            m_window_ms[stage] += ms;
+
+            if (stage == frame) {
+                m_frame_ms.push_back(ms);
+            }
+        }
+
+        m_seen[stage] = profiler.collected[stage];
+    }
+
+    if (m_frame_ms.size() < window_frames) {
+        return false;
+    }
+
+    auto p95 = m_frame_ms.begin() + static_cast<std::ptrdiff_t>(std::min(m_frame_ms.size() * 95 / 100, m_frame_ms.size() - 1));
+    std::nth_element(m_frame_ms.begin(), p95, m_frame_ms.end());
+    double p95_ms = *p95;
+
+    // only what the render thread waited for counts against the frame
+    auto stage_ms = [this](frame_stage stage) {
+        bool off_thread = m_sim_thread && (stage == frame_stage::particle_update || stage == frame_stage::noise_fill);
+        return off_thread ? 0.0 : m_window_ms[static_cast<std::size_t>(stage)];
+    };
+
+    double particle_ms = stage_ms(frame_stage::particle_update);
+    double ghost_ms = stage_ms(frame_stage::ghost_draw) + stage_ms(frame_stage::ghost_upload);
+    double field_ms = stage_ms(frame_stage::noise_fill) + stage_ms(frame_stage::texture_upload) + stage_ms(frame_stage::flow_lines);
+
+    m_frame_ms.clear();
+    m_window_ms.fill(0.0);
+
+    if (m_skip_windows > 0) {
+        m_skip_windows--;
+        return false;
+    }
+
+    bool changed = false;
+
+    if (p95_ms > m_budget_ms * high_water) {
+        changed = shed(particle_ms, ghost_ms, field_ms);
+
+        // the last upgrade did not fit, wait longer before the next one
+        if (changed && m_just_restored) {
+            m_upgrade_windows = std::min(m_upgrade_windows * 2, last_upgrade_windows);
+        }
+
+        m_calm_windows = 0;
+        m_just_restored = false;
+    } else if (p95_ms < m_budget_ms * low_water) {
+        m_just_restored = false;
+
+        if (++m_calm_windows >= m_upgrade_windows) {
+            m_calm_windows = 0;
+            changed = restore();
+            m_just_restored = changed;
+        }
+    } else {
+        m_calm_windows = 0;
+        m_just_restored = false;
+    }
+
+    if (changed) {
+        m_skip_windows = 1;
+    }
+
+    return changed;
+}
+
+quality_settings const & quality_controller::settings() const noexcept {
+    return m_settings;
+}
+
+bool quality_controller::shed(double particle_ms, double ghost_ms, double field_ms) noexcept {
+    if (particle_ms + ghost_ms >= field_ms) {
+        if (ghost_ms > particle_ms && sparser_trails()) {
+            return true;
+        }
+
+        return fewer_particles() || sparser_trails() || coarser_grid();
+    }
+
+    return coarser_grid() || fewer_particles() || sparser_trails();
+}
+
+bool quality_controller::restore() noexcept {
+    if (m_settings.particles < m_bounds.max_particles) {
+        m_settings.particles = std::min(m_bounds.max_particles, m_settings.particles + std::max<std::size_t>(1, m_settings.particles / 3));
+        return true;
+    }
+
+    if (m_settings.grid_divisor > m_bounds.min_grid_divisor) {
+        m_settings.grid_divisor = std::max(m_bounds.min_grid_divisor, m_settings.grid_divisor - std::max(1, m_settings.grid_divisor / 5));
+        return true;
+    }
+
+    if (m_settings.ghost_stride > 1) {
+        m_settings.ghost_stride /= 2;
+        return true;
+    }
+
+    return false;
+}
+
+bool quality_controller::fewer_particles() noexcept {
+    if (m_settings.particles <= m_bounds.min_particles) {
+        return false;
+    }
+
+    m_settings.particles = std::max(m_bounds.min_particles, m_settings.particles - std::max<std::size_t>(1, m_settings.particles / 4));
+    return true;
+}
+
+bool quality_controller::coarser_grid() noexcept {
+    if (m_settings.grid_divisor >= m_bounds.max_grid_divisor) {
+        return false;
+    }
+
+    m_settings.grid_divisor = std::min(m_bounds.max_grid_divisor, m_settings.grid_divisor + std::max(1, m_settings.grid_divisor / 4));
+    return true;
+}
+
+bool quality_controller::sparser_trails() noexcept {
+    if (m_settings.ghost_stride >= m_bounds.max_ghost_stride) {
+        return false;
+    }
+
+    m_settings.ghost_stride = std::min(m_bounds.max_ghost_stride, m_settings.ghost_stride * 2);
+    return true;
+}
@@ -0,0 +1,90 @@
+#ifndef quality_controller_hpp
+#define quality_controller_hpp
+
+// std
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// my
+#include "profiler.hpp"
+
+/* holds the frame time under a budget by trading quality for time, so one build runs
+ at the target frame rate on whatever machine it lands on.
+
+ update() reads the stage timings the frame_profiler has collected since the last call
+ and looks at them window_frames frames at a time. when the p95 frame time of a window
+ is over high_water of the budget it sheds load straight away, one notch of one knob:
+
+    particles       three quarters of the particles (particle update, ghost draw / upload)
+    grid divisor    a quarter coarser grid (noise fill, texture upload, flow lines)
+    ghost stride    trails for half as many particles (ghost draw / upload)
+
+ whichever of the two groups of stages cost more in that window gives up its knob first
+ - the ghost stride before the particles when drawing the trails is what costs, the
+ others when their knob is already at its bound. all three stay inside the bounds,
+ equal bounds lock a knob.
+
+ load is only added back after upgrade_windows windows in a row under low_water, one
+ notch in the other direction (particles first, then the grid, then the trails). the
+ gap between the two water marks is the hysteresis - a frame time between them changes
+ nothing. an upgrade that has to be shed again in the next window doubles the number
+ of calm windows the next one waits for, so a machine that sits right on the edge of a
+ notch settles below it instead of flipping every second. the window after any change
+ is skipped, it has the frames of the change itself in it.
+
+ with the simulation on its own thread (see sim_pipeline) the particle update and the
+ noise fill do not hold up the frame, only the stages of the render thread are weighed
+ against each other - particles then only cost their ghost trails.
+
+ the controller only decides, the caller applies settings() when update() returns true.
+*/
+
+struct quality_settings {
+    std::size_t particles;
+    int grid_divisor;
+    int ghost_stride;
+};
+
+struct quality_bounds {
+    std::size_t min_particles;
+    std::size_t max_particles;
+    int min_grid_divisor;
+    int max_grid_divisor;
+    int max_ghost_stride;
+};
+
+struct quality_controller {
+    static constexpr std::size_t window_frames = 30;
+    static constexpr double high_water = 0.9;
+    static constexpr double low_water = 0.65;
+    static constexpr int first_upgrade_windows = 4;
+    static constexpr int last_upgrade_windows = 64;
+
+    quality_controller(double budget_ms, quality_bounds const & bounds, quality_settings const & start, bool sim_thread = false) noexcept(false);
+
+    bool update(frame_profiler const & profiler); // true when settings() changed
+    quality_settings const & settings() const noexcept;
+
+private:
+    bool shed(double particle_ms, double ghost_ms, double field_ms) noexcept;
+    bool restore() noexcept;
+    bool fewer_particles() noexcept;
+    bool coarser_grid() noexcept;
+    bool sparser_trails() noexcept;
+
+    double m_budget_ms;
+    bool m_sim_thread; // the simulation stages run off the render thread
+    quality_bounds m_bounds;
+    quality_settings m_settings;
+    std::array<std::uint64_t, static_cast<std::size_t>(frame_stage::count)> m_seen; // frame_profiler::collected at the last look
+    std::array<double, static_cast<std::size_t>(frame_stage::count)> m_window_ms;  // per stage total over the window
+    std::vector<double> m_frame_ms;
+    int m_skip_windows;
+    int m_calm_windows;
+    int m_upgrade_windows;
+    bool m_just_restored;
+};
+
+#endif // quality_controller_hpp
@@ -0,0 +1,283 @@
+#include "render_passes.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// my
+#include "profiler.hpp"
+
+render_passes::render_passes(window_spec & window, thread_pool & workers, simulation const & sim, bool software_ghost) noexcept(false)
+:   window{window}
+,   workers{workers}
+,   lines{window.sdl_renderer, std::max(sim.particles.size(), sim.flow_field.size())}
+,   ghost{window.renderer_width, window.renderer_height}
+,   software_ghost{software_ghost}
+,   drawn_positions{}
+,   perlin_step{~std::uint64_t(0)}
+,   ghost_step{0}
+,   capture{nullptr}
+,   camera{window.renderer_width, window.renderer_height}
+,   ghost_view{camera.transform()}
+,   lod{}
+,   lod_spacing{0.0f}
+,   ghost_stride{1} {
+
+}
+
+void render_passes::begin_frame() noexcept {
+    // begin render -- clear the screen to white
+    SDL_SetRenderDrawColor(window.sdl_renderer, 255, 255, 255, 255);
+    SDL_RenderClear(window.sdl_renderer);
+}
+
+void render_passes::draw_perlin(sim_view const & sim) noexcept {
+    // the simulation was regridded, the textures follow the field
+    if (sim.grid_width != window.perlin_grid_width || sim.grid_height != window.perlin_grid_height) {
+        if (window.resize_perlin_textures(sim.grid_width, sim.grid_height) < 0) {
+            return;
+        }
+
+        perlin_step = ~std::uint64_t(0);
+    }
+
+    // draw perlin background into texture, only when the field has changed since the last upload
+    if (sim.steps == perlin_step) {
+        return;
+    }
+
+    stage_timer timer(frame_stage::texture_upload);
+    int perlin_pitch = 0;
+    std::uint32_t *perlin_pixels = window.lock_perlin_texture(&perlin_pitch);
+
+    if (perlin_pixels) {
+        sim.write_perlin_pixels(perlin_pixels, perlin_pitch);
+        window.unlock_perlin_texture();
+        perlin_step = sim.steps;
+    }
+}
+
+void render_passes::draw_flow_lines(sim_view const & sim) {
+    // draw flow field into texture
+    stage_timer timer(frame_stage::flow_lines);
+
+    SDL_SetRenderTarget(window.sdl_renderer, window.sdl_flow_field_texture);
+    SDL_RenderClear(window.sdl_renderer);
+    lines.begin(0, 0, 0, 255);
+
+    float xstep = (float)window.renderer_width / (float)sim.grid_width; 
+    float ystep = (float)window.renderer_height / (float)sim.grid_height; 
+
+    screen_transform view = camera.transform();
+    visible_rect visible = camera.visible();
+
+    // too many cells to the pixel - draw a level of the pyramid instead
+    if (lod_spacing > 0.0f) {
+        int level = flow_lod::level_for(std::min(xstep, ystep) * camera.zoom, lod_spacing);
+
+        if (level > 0 && (level = lod.update(sim, level, &workers)) > 0) {
+            draw_lod_lines(sim, level, view, visible);
+            lines.flush();
+            return;
+        }
+    }
+
+    // only the cells in view, with a cell either side for the lines that reach in
+    float reach = simulation::flow_strength;
+    int first_x = std::max(0, static_cast<int>(std::floor((visible.min_x - reach) / xstep)));
+    int first_y = std::max(0, static_cast<int>(std::floor((visible.min_y - reach) / ystep)));
+    int last_x = std::min(sim.grid_width - 1, static_cast<int>(std::ceil((visible.max_x + reach) / xstep)) + 1);
+    int last_y = std::min(sim.grid_height - 1, static_cast<int>(std::ceil((visible.max_y + reach) / ystep)) + 1);
+
+    float x_pos = first_x * xstep;
+    float y_pos = first_y * ystep;
+
+    for (int y = first_y; y <= last_y; y++) {
+        for (int x = first_x; x <= last_x; x++) {
+           // render perlin flow lines
+           int index = y * sim.grid_width + x;
+
+           int x1 = x_pos - xstep / 2;
+           int y1 = y_pos - ystep / 2;
+           int x2 = x1 + sim.flow_field[index].x;
+           int y2 = y1 + sim.flow_field[index].y;
+
+           if (visible.overlaps(x1, y1, x2, y2)) {
+               djc::math::vec2f from = view.apply(djc::math::vec2f(x1, y1));
+               djc::math::vec2f to = view.apply(djc::math::vec2f(x2, y2));
+               lines.push(from.x, from.y, to.x, to.y);
+           }
+
+           x_pos += xstep; 
+        }
+
+        x_pos = first_x * xstep;
+        y_pos += ystep;
+    }
+    lines.flush();
+}
+
+void render_passes::draw_lod_lines(sim_view const & sim, int level, screen_transform const & view, visible_rect const & visible) noexcept {
+    // a cell of the level spans 2^level grid cells, its line is as much longer
+    float span = static_cast<float>(1 << level);
+    float xstep = (float)window.renderer_width / (float)sim.grid_width;
+    float ystep = (float)window.renderer_height / (float)sim.grid_height;
+    float cell_width = xstep * span;
+    float cell_height = ystep * span;
+    float reach = simulation::flow_strength * span;
+
+    int width = lod.level_width(level);
+    int height = lod.level_height(level);
+    djc::math::vec2f const *field = lod.level_field(level);
+
+    int first_x = std::max(0, static_cast<int>(std::floor((visible.min_x - reach) / cell_width)));
+    int first_y = std::max(0, static_cast<int>(std::floor((visible.min_y - reach) / cell_height)));
+    int last_x = std::min(width - 1, static_cast<int>(std::ceil((visible.max_x + reach) / cell_width)) + 1);
+    int last_y = std::min(height - 1, static_cast<int>(std::ceil((visible.max_y + reach) / cell_height)) + 1);
+
+    for (int y = first_y; y <= last_y; y++) {
+        // the middle of where the lines of the grid cells under this one start
+        int below_first_y = y << level;
+        int below_last_y = std::min(((y + 1) << level) - 1, sim.grid_height - 1);
+        float y1 = (below_first_y + below_last_y) * 0.5f * ystep - ystep / 2;
+
+        for (int x = first_x; x <= last_x; x++) {
+            int below_first_x = x << level;
+            int below_last_x = std::min(((x + 1) << level) - 1, sim.grid_width - 1);
+            float x1 = (below_first_x + below_last_x) * 0.5f * xstep - xstep / 2;
+
+            djc::math::vec2f const & flow = field[static_cast<std::size_t>(y) * width + x];
+            float x2 = x1 + flow.x * span;
+            float y2 = y1 + flow.y * span;
+
+            if (visible.overlaps(x1, y1, x2, y2)) {
+                djc::math::vec2f from = view.apply(djc::math::vec2f(x1, y1));
+                djc::math::vec2f to = view.apply(djc::math::vec2f(x2, y2));
+                lines.push(from.x, from.y, to.x, to.y);
+            }
+        }
+    }
+}
+
+void render_passes::draw_ghost(sim_view const & sim, float alpha) {
+    // particles were added or removed - start every trail from where the particle is now
+    if (drawn_positions.size() != sim.particle_count) {
+        drawn_positions.clear();
+
+        for (std::size_t i = 0; i < sim.particle_count; i++) {
+            drawn_positions.push_back(sim.particles[i].last_position);
+        }
+    }
+
+    // the trails so far were drawn for another view of the simulation
+    screen_transform view = camera.transform();
+
+    if (view.scale_x != ghost_view.scale_x || view.scale_y != ghost_view.scale_y
+        || view.offset_x != ghost_view.offset_x || view.offset_y != ghost_view.offset_y) {
+        clear_ghost();
+        ghost_view = view;
+    }
+
+    // the trail segments for this frame - last drawn position to the interpolated one. a
+    // particle that wrapped round the screen edge skips the segment instead of drawing across,
+    // and one out of view is not drawn at all. with a ghost_stride above 1 only every
+    // ghost_stride'th particle leaves a trail, the rest just keep their drawn position
+    visible_rect visible = camera.visible();
+    std::uint64_t stepped = sim.steps - ghost_step;
+    ghost_step = sim.steps;
+
+    auto push_segments = [&](auto & target) {
+        float max_x = sim.width * 0.5f;
+        float max_y = sim.height * 0.5f;
+        int skip = 0;
+
+        for (std::size_t i = 0; i < sim.particle_count; i++) {
+            particle const & p = sim.particles[i];
+            djc::math::vec2f position = p.last_position + (p.current_position - p.last_position) * alpha;
+            djc::math::vec2f & drawn = drawn_positions[i];
+
+            bool moved = position.x != drawn.x || position.y != drawn.y;
+            bool born = p.lifetime != 0 && p.age < stepped;
+            bool trail = skip == 0;
+            skip = trail ? ghost_stride - 1 : skip - 1;
+
+            if (trail && moved && !born && std::abs(position.x - drawn.x) < max_x && std::abs(position.y - drawn.y) < max_y
+                && visible.overlaps(drawn.x, drawn.y, position.x, position.y)) {
+                djc::math::vec2f from = view.apply(drawn);
+                djc::math::vec2f to = view.apply(position);
+                target.push(from.x, from.y, to.x, to.y);
+            }
+
+            drawn = position;
+        }
+    };
+
+    // draw flow field affected effect 
+    if (software_ghost) {
+        {
+            stage_timer timer(frame_stage::ghost_draw);
+            ghost.begin(0, 0, 0, 10);
+            push_segments(ghost);
+            ghost.rasterize(workers);
+        }
+
+        stage_timer timer(frame_stage::ghost_upload);
+        ghost.upload(window.sdl_gost_texture);
+    } else {
+        stage_timer timer(frame_stage::ghost_draw);
+
+        SDL_SetRenderTarget(window.sdl_renderer, window.sdl_gost_texture);
+        SDL_SetRenderDrawBlendMode(window.sdl_renderer, SDL_BLENDMODE_BLEND);
+        lines.begin(0, 0, 0, 10);
+        push_segments(lines);
+        lines.flush();
+    }
+}
+
+void render_passes::clear_ghost() noexcept {
+    SDL_SetRenderTarget(window.sdl_renderer, window.sdl_gost_texture);
+    SDL_SetRenderDrawColor(window.sdl_renderer, 255, 255, 255, 255);
+    SDL_RenderClear(window.sdl_renderer);
+    ghost.clear(255, 255, 255, 255);
+}
+
+void render_passes::present(int current_frame_buffer) noexcept {
+    // end render
+    stage_timer timer(frame_stage::present);
+
+    SDL_SetRenderTarget(window.sdl_renderer, NULL);
+          
+    // perlin background animation - copy into back buffer
+    if (current_frame_buffer == 0) {
+        if (camera.is_identity()) {
+            SDL_RenderCopy(window.sdl_renderer, window.sdl_perlin_texture, NULL, NULL);
+        } else {
+            // the whole texture at the camera's scale, the renderer clips it to the screen
+            screen_transform view = camera.transform();
+            djc::math::vec2f from = view.apply(djc::math::vec2f(0.0f, 0.0f));
+            djc::math::vec2f to = view.apply(djc::math::vec2f(static_cast<float>(window.renderer_width), static_cast<float>(window.renderer_height)));
+            SDL_Rect target{static_cast<int>(std::floor(from.x)), static_cast<int>(std::floor(from.y)),
+                            static_cast<int>(std::ceil(to.x - from.x)), static_cast<int>(std::ceil(to.y - from.y))};
+            SDL_RenderCopy(window.sdl_renderer, window.sdl_perlin_texture, NULL, &target);
+        }
+    }
+    
+    // flow field lines - copy into backbuffer 
+    if (current_frame_buffer == 1) {
+        SDL_RenderCopy(window.sdl_renderer, window.sdl_flow_field_texture, NULL, NULL);
+    }
+    
+    // gosting line effect - copy into back buffer 
+    if (current_frame_buffer == 2) {
+        SDL_RenderCopy(window.sdl_renderer, window.sdl_gost_texture, NULL, NULL);
+    }
+    
+    // read back before present, the back buffer is undefined afterwards
+    if (capture) {
+        stage_timer capture_timer(frame_stage::capture);
+        capture->capture(window.sdl_renderer);
+    }
+    
+    SDL_RenderPresent(window.sdl_renderer); // swap back bufer to front
+}
@@ -0,0 +1,77 @@
+#ifndef render_passes_hpp
+#define render_passes_hpp
+
+// std
+#include <vector>
+#include <cstdint>
+
+// my
+#include "sdl_module.hpp"
+#include "simulation.hpp"
+#include "line_batch.hpp"
+#include "ghost_rasterizer.hpp"
+#include "thread_pool.hpp"
+#include "frame_capture.hpp"
+#include "camera.hpp"
+#include "flow_lod.hpp"
+
+/* the per frame drawing, shared by the app and the benchmarks.
+
+ each pass draws one of the three frame buffers from the simulation state and
+ times itself with a stage_timer, present() copies the selected buffer to the
+ screen (or the off screen surface when headless).
+
+ the simulation steps at its own fixed rate, so a frame can land between two steps.
+ the ghost trails are drawn from where each particle was drawn last frame to its
+ position interpolated alpha of the way from the previous step to the current one,
+ which keeps the trails continuous whether a frame ran 0, 1 or several steps. the
+ perlin background is only uploaded again when the simulation has stepped.
+
+ when capture is set, present() also hands the composed frame to it just before it
+ is shown.
+
+ everything is drawn through camera. flow lines only loop over the grid cells in view,
+ ghost segments outside the view are dropped before they are transformed or pushed, and
+ the perlin texture is stretched so only its visible part lands on screen - zoomed in,
+ a frame only pays for what is on screen (plus one cheap test per particle). the ghost
+ trails are kept in screen space, so they start again whenever the camera moves. a
+ particle born again since the last frame (see simulation::lifetime) starts a new trail
+ where it was born instead of drawing one from where it died.
+
+ with lod_spacing set, grid cells that are closer than that on screen are drawn a level
+ of the flow_lod pyramid at a time instead - one line for every 2 x 2, 4 x 4, ... cells,
+ whichever first puts the lines lod_spacing apart. the number of lines then follows the
+ screen size, not the grid size, and zooming in walks back down to one line per cell.
+
+ the perlin textures follow the grid size of the view, so a regridded simulation (see
+ quality_controller) just draws at its new resolution.
+*/
+
+struct render_passes {
+    window_spec & window;
+    thread_pool & workers;
+    line_batch lines;
+    ghost_rasterizer ghost;
+    bool software_ghost;
+    std::vector<djc::math::vec2f> drawn_positions;
+    std::uint64_t perlin_step;
+    std::uint64_t ghost_step; // the step the ghost trails were last drawn at
+    frame_capture *capture; // null when not capturing
+    camera_2d camera;
+    screen_transform ghost_view; // the camera the ghost trails so far were drawn with
+    flow_lod lod;
+    float lod_spacing; // least on screen pixels between flow lines, 0 draws every cell
+    int ghost_stride;  // one particle in ghost_stride leaves a trail
+
+    render_passes(window_spec & window, thread_pool & workers, simulation const & sim, bool software_ghost) noexcept(false);
+
+    void begin_frame() noexcept;
+    void draw_perlin(sim_view const & sim) noexcept;
+    void draw_flow_lines(sim_view const & sim);
+    void draw_lod_lines(sim_view const & sim, int level, screen_transform const & view, visible_rect const & visible) noexcept;
+    void draw_ghost(sim_view const & sim, float alpha = 1.0f);
+    void clear_ghost() noexcept;
+    void present(int current_frame_buffer) noexcept;
+};
+
+#endif // render_passes_hpp
@@ -2,9 +2,12 @@
 
 window_spec::window_spec(int dpi_unscaled_width, int dpi_unscaled_height, int perlin_grid_divisor, Uint32 flags) noexcept(false) 
 :   sdl_window{nullptr}
+,   sdl_surface{nullptr}
 ,   sdl_renderer{nullptr}
 ,   sdl_gost_texture{nullptr}
 ,   sdl_perlin_texture{nullptr}
+,   sdl_perlin_textures{nullptr, nullptr}
+,   perlin_write_index{0}
 ,   sdl_flow_field_texture{nullptr}
 ,   x{SDL_WINDOWPOS_CENTERED}
 ,   y{SDL_WINDOWPOS_CENTERED}
@@ -15,36 +18,45 @@ window_spec::window_spec(int dpi_unscaled_width, int dpi_unscaled_height, int pe
 ,   dpi_scaled_height{dpi_unscaled_height}
 ,   renderer_width{dpi_unscaled_width}
 ,   renderer_height{dpi_unscaled_width}
-,   flags{flags} {
+,   flags{flags}
+,   headless{false} {
 
 }
 
 window_spec::~window_spec() {
     SDL_DestroyTexture(sdl_flow_field_texture);
-    SDL_DestroyTexture(sdl_perlin_texture); 
+    SDL_DestroyTexture(sdl_perlin_textures[1]); 
+    SDL_DestroyTexture(sdl_perlin_textures[0]); 
     SDL_DestroyTexture(sdl_gost_texture);
     SDL_RenderClear(sdl_renderer);
     SDL_DestroyRenderer(sdl_renderer);
     SDL_DestroyWindow(sdl_window);
+    SDL_FreeSurface(sdl_surface);
 }
 
 int window_spec::init() {
-    float dpi;
-    float default_dpi;
+    if (headless) {
+        if (init_headless() < 0) {
+            return -1;
+        }
+    } else {
+        float dpi;
+        float default_dpi;
 
-    my_sdl_get_display_dpi(0, &dpi, &default_dpi);
+        my_sdl_get_display_dpi(0, &dpi, &default_dpi);
 
-    dpi_scaled_width = static_cast<int>(dpi_unscaled_width * dpi / default_dpi);
-    dpi_scaled_height = static_cast<int>(dpi_unscaled_height * dpi / default_dpi); 
+        dpi_scaled_width = static_cast<int>(dpi_unscaled_width * dpi / default_dpi);
+        dpi_scaled_height = static_cast<int>(dpi_unscaled_height * dpi / default_dpi); 
 
-    if ((sdl_window = SDL_CreateWindow("PerlinFlowField", x, y, dpi_scaled_width, dpi_scaled_height, flags)) == nullptr) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", SDL_GetError());
-        return -1;
-    }
+        if ((sdl_window = SDL_CreateWindow("PerlinFlowField", x, y, dpi_scaled_width, dpi_scaled_height, flags)) == nullptr) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", SDL_GetError());
+            return -1;
+        }
 
-    if ((sdl_renderer = SDL_CreateRenderer(sdl_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE)) == nullptr) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", SDL_GetError());
-        return -1;
+        if ((sdl_renderer = SDL_CreateRenderer(sdl_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE)) == nullptr) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", SDL_GetError());
+            return -1;
+        }
     }
 
     if (SDL_GetRendererOutputSize(sdl_renderer, &renderer_width, &renderer_height) < 0) {
@@ -60,8 +72,7 @@ int window_spec::init() {
         return -1;
     }
 
-    if((sdl_perlin_texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, perlin_grid_width, perlin_grid_height)) == nullptr) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", SDL_GetError());
+    if (resize_perlin_textures(perlin_grid_width, perlin_grid_height) < 0) {
         return -1;
     }
 
@@ -71,6 +82,7 @@ int window_spec::init() {
     }
     
     std::cout << "\n------- window info ------\n";
+    std::cout << "headless:         " << (headless ? "true" : "false") << '\n';
     std::cout << "dpi unscaled dim: " << dpi_unscaled_width << " x " << dpi_unscaled_height << '\n';
     std::cout << "dpi scaled dim:   " << dpi_scaled_width << " x " << dpi_scaled_height << '\n';
     std::cout << "renderer dim:     " << renderer_width << " x " << renderer_height << '\n';
@@ -87,12 +99,72 @@ int window_spec::init() {
     return 0;
 }
 
+int window_spec::resize_perlin_textures(int grid_width, int grid_height) {
+    for (SDL_Texture *& texture : sdl_perlin_textures) {
+        if (texture) {
+            SDL_DestroyTexture(texture);
+        }
+
+        if((texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, grid_width, grid_height)) == nullptr) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", SDL_GetError());
+            return -1;
+        }
+    }
+
+    perlin_grid_width = grid_width;
+    perlin_grid_height = grid_height;
+    sdl_perlin_texture = sdl_perlin_textures[1];
+    perlin_write_index = 0;
+    return 0;
+}
+
+std::uint32_t * window_spec::lock_perlin_texture(int *pitch) {
+    void *pixels = nullptr;
+
+    // the noise is written straight into texture memory, so there is no staging copy
+    if (SDL_LockTexture(sdl_perlin_textures[perlin_write_index], NULL, &pixels, pitch) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", SDL_GetError());
+        return nullptr;
+    }
+
+    return static_cast<std::uint32_t *>(pixels);
+}
+
+void window_spec::unlock_perlin_texture() {
+    SDL_UnlockTexture(sdl_perlin_textures[perlin_write_index]);
+    
+    // the texture just written becomes the one shown, the other one is written next frame
+    sdl_perlin_texture = sdl_perlin_textures[perlin_write_index];
+    perlin_write_index ^= 1;
+}
+
+int window_spec::init_headless() {
+    // no display to ask for a dpi, so the unscaled size is the output size
+    dpi_scaled_width = dpi_unscaled_width;
+    dpi_scaled_height = dpi_unscaled_height;
+
+    if ((sdl_surface = SDL_CreateRGBSurfaceWithFormat(0, dpi_scaled_width, dpi_scaled_height, 32, SDL_PIXELFORMAT_ARGB8888)) == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", SDL_GetError());
+        return -1;
+    }
+
+    // the software renderer draws straight into the surface - no window, vsync or compositor
+    if ((sdl_renderer = SDL_CreateSoftwareRenderer(sdl_surface)) == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", SDL_GetError());
+        return -1;
+    }
+
+    return 0;
+}
+
 void window_spec::my_sdl_get_display_dpi(int display_index, float *dpi, float *default_dpi) {
     const float system_default_dpi =
     #ifdef __APPLE__
         72.0f;
     #elif defined(_WIN32)
          96.0f;
+    #elif defined(__linux__)
+         96.0f;
     #else
         static_assert(false, "No system default DPI set for this platform.");
     #endif
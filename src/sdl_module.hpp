@@ -3,15 +3,19 @@
 
 // std
 #include <iostream>
+#include <cstdint>
 
 // dependancies
 #include "SDL2/SDL.h"
 
 struct window_spec {
     SDL_Window *sdl_window;
+    SDL_Surface *sdl_surface; // off screen render target when headless
     SDL_Renderer *sdl_renderer;
     SDL_Texture *sdl_gost_texture;
-    SDL_Texture *sdl_perlin_texture;
+    SDL_Texture *sdl_perlin_texture; // last completed perlin frame, the one to copy to the screen
+    SDL_Texture *sdl_perlin_textures[2]; // streaming textures, one is written while the other is shown
+    int perlin_write_index;
     SDL_Texture * sdl_flow_field_texture;
     int x;
     int y;
@@ -25,14 +29,20 @@ struct window_spec {
     int perlin_grid_width;
     int perlin_grid_height;
     Uint32 flags; 
+    bool headless; // set before init() to render into sdl_surface with the software renderer instead of a window
     
     window_spec(int dpi_unscaled_width, int dpi_unscaled_height, int perlin_grid_divisor = 20, Uint32 flags = SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL | SDL_WINDOW_ALLOW_HIGHDPI) noexcept(false);
 
     ~window_spec(); 
 
    int init(); 
+   int resize_perlin_textures(int grid_width, int grid_height); // after the simulation's grid changed
+
+   std::uint32_t * lock_perlin_texture(int *pitch); 
+   void unlock_perlin_texture();
     
 private:
+    int init_headless();
     void my_sdl_get_display_dpi(int display_index, float *dpi, float *defaultDpi);
 
 };
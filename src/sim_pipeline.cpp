@@ -0,0 +1,148 @@
+#include "sim_pipeline.hpp"
+
+// std
+#include <algorithm>
+
+// my
+#include "tracer.hpp"
+#include "flow_field_generator.hpp"
+
+sim_pipeline::sim_pipeline(simulation & sim, thread_pool & workers, fixed_timestep timestep) noexcept(false)
+:   m_sim{sim}
+,   m_workers{workers}
+,   m_timestep{timestep}
+,   m_snapshots{}
+,   m_back{0}
+,   m_front{2}
+,   m_middle{1}
+,   m_pan_x{0}
+,   m_pan_y{0}
+,   m_particle_count{0}
+,   m_grid_divisor{0}
+,   m_running{false}
+,   m_thread{} {
+
+    // the renderer has the starting state to draw until the first step lands
+    publish();
+    m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & index_mask;
+}
+
+sim_pipeline::~sim_pipeline() {
+    stop();
+}
+
+void sim_pipeline::start() {
+    if (m_running.exchange(true)) {
+        return;
+    }
+
+    m_thread = std::thread(&sim_pipeline::thread_loop, this);
+}
+
+void sim_pipeline::stop() noexcept {
+    m_running.store(false);
+
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+sim_view sim_pipeline::acquire() noexcept {
+    if (m_middle.load(std::memory_order_relaxed) & fresh_bit) {
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & index_mask;
+    }
+
+    snapshot const & s = m_snapshots[m_front];
+    return sim_view{m_sim.width, m_sim.height, s.grid_width, s.grid_height,
+                    s.particles.data(), s.particles.size(), s.flow_field.data(), s.shades.data(), s.steps};
+}
+
+void sim_pipeline::pan(int cells_x, int cells_y) noexcept {
+    m_pan_x.fetch_add(cells_x, std::memory_order_relaxed);
+    m_pan_y.fetch_add(cells_y, std::memory_order_relaxed);
+}
+
+void sim_pipeline::resize_particles(std::size_t count) noexcept {
+    m_particle_count.store(count, std::memory_order_relaxed);
+}
+
+void sim_pipeline::regrid(int divisor) noexcept {
+    m_grid_divisor.store(divisor, std::memory_order_relaxed);
+}
+
+float sim_pipeline::alpha() const noexcept {
+    if (m_timestep.hz <= 0) {
+        return 1.0f;
+    }
+
+    double since = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_snapshots[m_front].stepped_at).count();
+    return static_cast<float>(std::clamp(since / m_timestep.step_seconds, 0.0, 1.0));
+}
+
+void sim_pipeline::publish() {
+    snapshot & s = m_snapshots[m_back];
+    std::size_t cells = m_sim.flow_field.size();
+    s.particles = m_sim.particles;
+    s.flow_field.assign(m_sim.current_flow_field(), m_sim.current_flow_field() + cells);
+    s.shades.assign(m_sim.current_shades(), m_sim.current_shades() + cells);
+    s.grid_width = m_sim.grid_width;
+    s.grid_height = m_sim.grid_height;
+    s.steps = m_sim.steps;
+    s.stepped_at = std::chrono::steady_clock::now();
+
+    m_back = m_middle.exchange(m_back | fresh_bit, std::memory_order_acq_rel) & index_mask;
+}
+
+void sim_pipeline::regrid_now(int divisor) {
+    // the generator reads the grid size of the simulation, it sits the change out
+    flow_field_generator *generator = m_sim.generator;
+
+    if (generator) {
+        generator->stop();
+    }
+
+    m_sim.regrid(divisor, &m_workers);
+
+    if (generator) {
+        generator->regrid();
+        generator->start();
+    }
+}
+
+void sim_pipeline::thread_loop() {
+    using clock = std::chrono::steady_clock;
+    auto step = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(m_timestep.step_seconds));
+    auto next = clock::now();
+
+    while (m_running.load(std::memory_order_relaxed)) {
+        if (m_timestep.hz > 0) {
+            std::this_thread::sleep_until(next);
+            next += step;
+
+            // fell more than max_substeps behind - drop the backlog instead of trying to catch up
+            auto now = clock::now();
+            if (now - next > step * m_timestep.max_substeps) {
+                next = now;
+            }
+        }
+
+        {
+            trace_scope trace("sim step");
+            m_sim.pan(m_pan_x.exchange(0, std::memory_order_relaxed), m_pan_y.exchange(0, std::memory_order_relaxed));
+
+            std::size_t count = m_particle_count.exchange(0, std::memory_order_relaxed);
+            int divisor = m_grid_divisor.exchange(0, std::memory_order_relaxed);
+
+            if (count > 0 && count != m_sim.particles.size()) {
+                m_sim.resize_particles(count);
+            }
+
+            if (divisor > 0 && divisor != m_sim.grid_divisor) {
+                regrid_now(divisor);
+            }
+
+            m_sim.tick(&m_workers);
+            publish();
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef sim_pipeline_hpp
+#define sim_pipeline_hpp
+
+// std
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// my
+#include "djc_math/djc_math.hpp"
+#include "simulation.hpp"
+#include "thread_pool.hpp"
+#include "fixed_timestep.hpp"
+
+/* runs the simulation on its own thread so stepping and rendering overlap - a frame
+ costs max(sim, render) instead of sim + render.
+
+ after every fixed step the simulation thread copies what the renderer needs into
+ one of three snapshots (triple buffering). the thread owns the back snapshot, the
+ renderer owns the front one and the middle one is handed between them with a single
+ atomic exchange of its index, so neither side ever waits on the other. acquire()
+ swaps in the middle snapshot if a newer step has been published since the last call,
+ otherwise the renderer keeps drawing the one it has.
+
+ once start() is called the simulation belongs to the thread until stop() - only
+ touch it through the snapshots. the thread steps at timestep.hz, running at most
+ max_substeps late steps back to back before dropping the backlog, same as the
+ single threaded loop.
+
+ pan(), resize_particles() and regrid() are handed to the thread and applied before its
+ next step. a regrid stops the flow field generator while its buffers are rebuilt, and
+ every snapshot carries its own grid size, so the renderer can tell when it changed.
+*/
+
+struct sim_pipeline {
+    sim_pipeline(simulation & sim, thread_pool & workers, fixed_timestep timestep) noexcept(false);
+    ~sim_pipeline();
+
+    sim_pipeline(sim_pipeline const &) = delete;
+    sim_pipeline & operator = (sim_pipeline const &) = delete;
+
+    void start();
+    void stop() noexcept;
+
+    sim_view acquire() noexcept; // latest complete step, valid until the next acquire
+    void pan(int cells_x, int cells_y) noexcept; // simulation::pan from the render thread
+    void resize_particles(std::size_t count) noexcept; // 0 is no change
+    void regrid(int divisor) noexcept;                  // 0 is no change
+    float alpha() const noexcept; // how far now is into the step after the acquired one
+
+private:
+    struct snapshot {
+        std::vector<particle> particles;
+        std::vector<djc::math::vec2f> flow_field;
+        std::vector<std::uint8_t> shades;
+        int grid_width;
+        int grid_height;
+        std::uint64_t steps;
+        std::chrono::steady_clock::time_point stepped_at;
+    };
+
+    static constexpr unsigned index_mask = 3;
+    static constexpr unsigned fresh_bit = 4;
+
+    void thread_loop();
+    void publish();
+    void regrid_now(int divisor);
+
+    simulation & m_sim;
+    thread_pool & m_workers;
+    fixed_timestep m_timestep;
+    snapshot m_snapshots[3];
+    unsigned m_back;
+    unsigned m_front;
+    std::atomic<unsigned> m_middle;
+    std::atomic<int> m_pan_x; // handed to the simulation before its next step
+    std::atomic<int> m_pan_y;
+    std::atomic<std::size_t> m_particle_count; // 0 for no change
+    std::atomic<int> m_grid_divisor;           // 0 for no change
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+};
+
+#endif // sim_pipeline_hpp
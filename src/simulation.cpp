@@ -0,0 +1,327 @@
+#include "simulation.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// my
+#include "profiler.hpp"
+#include "flow_field_generator.hpp"
+#include "field_sequence.hpp"
+#include "chunked_field.hpp"
+
+simulation::simulation(int width, int height, int grid_divisor, std::size_t particle_count, unsigned int seed) noexcept(false)
+:   width{width}
+,   height{height}
+,   grid_divisor{grid_divisor}
+,   grid_width{width / grid_divisor}
+,   grid_height{height / grid_divisor}
+,   seed{seed}
+,   noisy{seed}
+,   flow_field(static_cast<std::size_t>(grid_width) * grid_height, djc::math::vec2f(0, 0))
+,   particles{}
+,   shades(flow_field.size(), 0)
+,   zstep{0.0}
+,   steps{0}
+,   rng_state{0x9e3779b97f4a7c15ull ^ seed}
+,   generator{nullptr}
+,   generated{nullptr}
+,   playback{nullptr}
+,   world{nullptr}
+,   lifetime{0}
+,   emitter{width, height}
+,   free_slots{}
+,   spawn_positions{}
+,   camera_x{0}
+,   camera_y{0}
+,   pan_x{0}
+,   pan_y{0} {
+
+    // same seed, same starting particles (positions here and velocities in the particle constructor)
+    std::srand(seed);
+    particles.assign(particle_count, particle(djc::math::vec2f(0, 0)));
+
+    // give the particles random initial positions
+    for (particle & p : particles) {
+        p = djc::math::vec2f(std::rand() % width, std::rand() % height);
+    }
+}
+
+namespace {
+    constexpr std::size_t particle_chunk = 4096;
+
+    constexpr std::uint64_t fnv_offset = 14695981039346656037ull;
+    constexpr std::uint64_t fnv_prime  = 1099511628211ull;
+
+    void hash_bytes(std::uint64_t & hash, void const *data, std::size_t size) noexcept {
+        unsigned char const *bytes = static_cast<unsigned char const *>(data);
+
+        for (std::size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= fnv_prime;
+        }
+    }
+
+    void hash_vec(std::uint64_t & hash, djc::math::vec2f const & v) noexcept {
+        hash_bytes(hash, &v.x, sizeof(v.x));
+        hash_bytes(hash, &v.y, sizeof(v.y));
+    }
+}
+
+void simulation::update_particles(thread_pool *workers) {
+    djc::math::vec2f const *field = current_flow_field();
+    std::uint32_t mean_lifetime = lifetime;
+
+    // only grows with the particle count, never per step
+    if (mean_lifetime > 0 && free_slots.size() < particles.size()) {
+        free_slots.resize(particles.size());
+        spawn_positions.resize(particles.size());
+    }
+
+    auto update_chunk = [this, field, mean_lifetime](std::size_t chunk) {
+        std::size_t begin = chunk * particle_chunk;
+        std::size_t end = std::min(particles.size(), (chunk + 1) * particle_chunk);
+        std::size_t dead = 0;
+        spawn_rng rng(rng_state + steps * 0x9e3779b97f4a7c15ull, chunk);
+
+        auto draw_lifetime = [&rng, mean_lifetime]() {
+            return std::max<std::uint32_t>(1, mean_lifetime / 2 + rng.next() % (mean_lifetime + 1));
+        };
+
+        for (std::size_t i = begin; i < end; i++) {
+            particle & p = particles[i];
+
+            // make sure particles do screen wrapping
+            if (p.current_position.x < 0) p.current_position.x = width;
+            if (p.current_position.x > width) p.current_position.x = 0;
+            if (p.current_position.y < 0) p.current_position.y = height;
+            if (p.current_position.y > height) p.current_position.y = 0;
+            
+            // get the particle position in the perlin grid - one cell per grid_divisor pixels, and
+            // a particle sitting exactly on the far edge still belongs to the last cell
+            int grid_x = std::clamp(static_cast<int>(std::floor(p.current_position.x / grid_divisor)), 0, grid_width - 1); 
+            int grid_y = std::clamp(static_cast<int>(std::floor(p.current_position.y / grid_divisor)), 0, grid_height - 1);
+            int index  = grid_y * grid_width + grid_x;  
+            
+            // update the particle using the perlin grid 
+            p.last_position = p.current_position;
+            p.acceleration += field[index] * 0.01f; 
+            p.velocity += p.acceleration;
+            p.velocity = djc::math::limit(p.velocity, 4.0f);
+            p.current_position += p.velocity;
+            p.acceleration *= 0.0f; // reset 
+
+            if (mean_lifetime > 0) {
+                if (p.lifetime == 0) {
+                    p.lifetime = draw_lifetime();
+                }
+
+                if (++p.age >= p.lifetime) {
+                    free_slots[begin + dead++] = static_cast<std::uint32_t>(i);
+                }
+            }
+        }
+
+        // born again in the slots the dead just freed
+        emitter.emit(rng, dead, spawn_positions.data() + begin);
+
+        for (std::size_t k = 0; k < dead; k++) {
+            particle & p = particles[free_slots[begin + k]];
+            p.current_position = spawn_positions[begin + k];
+            p.last_position = p.current_position;
+            p.velocity = djc::math::vec2f(std::cos(static_cast<float>(rng.next())), std::sin(static_cast<float>(rng.next())));
+            p.acceleration = djc::math::vec2f(0, 0);
+            p.age = 0;
+            p.lifetime = draw_lifetime();
+        }
+    };
+
+    std::size_t chunks = (particles.size() + particle_chunk - 1) / particle_chunk;
+
+    if (workers) {
+        workers->parallel_for(chunks, update_chunk, "particle chunks");
+    } else {
+        for (std::size_t chunk = 0; chunk < chunks; chunk++) update_chunk(chunk);
+    }
+}
+
+void simulation::update_flow_field(std::uint32_t *pixels, int pitch, thread_pool *workers) {
+    fill_flow_field(zstep, flow_field.data(), shades.data(), pixels, pitch, workers);
+}
+
+void simulation::fill_flow_field(double z, djc::math::vec2f *field, std::uint8_t *field_shades, std::uint32_t *pixels, int pitch, thread_pool *workers) const {
+    auto update_row = [this, z, field, field_shades, pixels, pitch](std::size_t row_index) {
+        int y = static_cast<int>(row_index);
+        std::uint32_t *row = pixels ? pixels + y * (pitch / sizeof(std::uint32_t)) : nullptr;
+
+        for (int x = 0; x < grid_width; x++) {
+            double X = (double)x / (double)grid_width;
+            double Y = (double)y / (double)grid_height;
+          
+            float angle = noisy.noise(X * 5 ,Y * 5 , z); 
+            std::uint8_t noise = angle * 255; 
+            int index = grid_width * y + x;
+            field_shades[index] = noise;
+            
+            if (row) {
+                row[x] = (255 << 24) + (noise << 16) + (noise << 8) + noise; 
+            }
+
+            field[index] = djc::math::vec2f(std::cos(angle * djc::math::tau<float>), std::sin(angle * djc::math::tau<float>)) * flow_strength;
+        }
+    };
+
+    if (workers) {
+        workers->parallel_for(grid_height, update_row, "flow field rows");
+    } else {
+        for (int y = 0; y < grid_height; y++) update_row(y);
+    }
+}
+
+void simulation::step() noexcept {
+    zstep += 0.005f;
+    steps++;
+}
+
+void simulation::pan(int cells_x, int cells_y) noexcept {
+    pan_x += cells_x;
+    pan_y += cells_y;
+}
+
+void simulation::move_camera(thread_pool *workers) {
+    if (pan_x == 0 && pan_y == 0) {
+        return;
+    }
+
+    camera_x += pan_x;
+    camera_y += pan_y;
+
+    // the whole trail moves, so a panned particle does not draw a line across the screen
+    djc::math::vec2f shift(static_cast<float>(pan_x * grid_divisor), static_cast<float>(pan_y * grid_divisor));
+    pan_x = 0;
+    pan_y = 0;
+
+    std::size_t chunks = (particles.size() + particle_chunk - 1) / particle_chunk;
+    auto shift_chunk = [this, shift](std::size_t chunk) {
+        std::size_t end = std::min(particles.size(), (chunk + 1) * particle_chunk);
+
+        for (std::size_t i = chunk * particle_chunk; i < end; i++) {
+            particles[i].current_position -= shift;
+            particles[i].last_position -= shift;
+        }
+    };
+
+    if (workers) {
+        workers->parallel_for(chunks, shift_chunk, "particle chunks");
+    } else {
+        for (std::size_t chunk = 0; chunk < chunks; chunk++) shift_chunk(chunk);
+    }
+}
+
+void simulation::resize_particles(std::size_t count) {
+    std::size_t old_count = particles.size();
+    particles.resize(count, particle(djc::math::vec2f(0, 0)));
+
+    // from the simulation's own random stream, not std::rand, so a snapshot replays them
+    for (std::size_t i = old_count; i < count; i++) {
+        particle & p = particles[i];
+        p.current_position = djc::math::vec2f(static_cast<float>(random() % width), static_cast<float>(random() % height));
+        p.last_position = p.current_position;
+        p.velocity = djc::math::vec2f(std::cos(static_cast<float>(random())), std::sin(static_cast<float>(random())));
+        p.acceleration = djc::math::vec2f(0, 0);
+    }
+}
+
+void simulation::regrid(int divisor, thread_pool *workers) {
+    grid_divisor = divisor;
+    grid_width = width / divisor;
+    grid_height = height / divisor;
+    flow_field.assign(static_cast<std::size_t>(grid_width) * grid_height, djc::math::vec2f(0, 0));
+    shades.assign(flow_field.size(), 0);
+    generated = nullptr; // a generator's buffers are the old size until it is regridded too
+
+    update_flow_field(nullptr, 0, workers);
+}
+
+std::uint32_t simulation::random() noexcept {
+    // splitmix64 - one word of state, so it snapshots and restores trivially
+    std::uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return static_cast<std::uint32_t>((z ^ (z >> 31)) >> 32);
+}
+
+void simulation::tick(thread_pool *workers) {
+    if (generator) {
+        generated = generator->acquire();
+    }
+
+    {
+        stage_timer timer(frame_stage::particle_update);
+        update_particles(workers);
+    }
+
+    if (world) {
+        move_camera(workers);
+    }
+
+    if (playback) {
+        stage_timer timer(frame_stage::noise_fill);
+        playback->read_step(steps, flow_field.data(), shades.data());
+    } else if (world) {
+        stage_timer timer(frame_stage::noise_fill);
+        world->fill_window(camera_x, camera_y, grid_width, grid_height, zstep, flow_field.data(), shades.data(), workers);
+    } else if (generator) {
+        generator->request(zstep);
+    } else {
+        stage_timer timer(frame_stage::noise_fill);
+        update_flow_field(nullptr, 0, workers);
+    }
+
+    step();
+}
+
+djc::math::vec2f const *simulation::current_flow_field() const noexcept {
+    return generated ? generated->flow_field.data() : flow_field.data();
+}
+
+std::uint8_t const *simulation::current_shades() const noexcept {
+    return generated ? generated->shades.data() : shades.data();
+}
+
+sim_view simulation::view() const noexcept {
+    return sim_view{width, height, grid_width, grid_height, particles.data(), particles.size(), current_flow_field(), current_shades(), steps};
+}
+
+void sim_view::write_perlin_pixels(std::uint32_t *pixels, int pitch) const noexcept {
+    for (int y = 0; y < grid_height; y++) {
+        std::uint32_t *row = pixels + y * (pitch / sizeof(std::uint32_t));
+        std::uint8_t const *shade = shades + static_cast<std::size_t>(y) * grid_width;
+
+        for (int x = 0; x < grid_width; x++) {
+            std::uint32_t noise = shade[x];
+            row[x] = (255u << 24) + (noise << 16) + (noise << 8) + noise;
+        }
+    }
+}
+
+std::uint64_t simulation::state_hash() const noexcept {
+    std::uint64_t hash = fnv_offset;
+
+    for (particle const & p : particles) {
+        hash_vec(hash, p.current_position);
+        hash_vec(hash, p.last_position);
+        hash_vec(hash, p.velocity);
+        hash_vec(hash, p.acceleration);
+    }
+
+    djc::math::vec2f const *field = current_flow_field();
+
+    for (std::size_t i = 0; i < flow_field.size(); i++) {
+        hash_vec(hash, field[i]);
+    }
+
+    hash_bytes(hash, &zstep, sizeof(zstep));
+    return hash;
+}
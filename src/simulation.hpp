@@ -0,0 +1,131 @@
+#ifndef simulation_hpp
+#define simulation_hpp
+
+// std
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// my
+#include "djc_math/djc_math.hpp"
+#include "particle.hpp"
+#include "thread_pool.hpp"
+#include "emitter.hpp"
+
+/* the particle and flow field state, kept separate from window_spec so it can be
+ stepped without a window, renderer or display.
+
+ width / height are the size of the area the particles move in (the renderer output
+ size when there is a window) and the flow field has one cell per grid_divisor pixels.
+ seed drives both the noise permutation and the particles starting state. anything
+ random after that draws from random(), whose whole state is rng_state, so a snapshot
+ (see snapshot.hpp) restores the random stream along with everything else.
+
+ both updates can be split across a thread pool. every particle and every flow field
+ cell only writes its own slot, so the result is the same for any thread count -
+ state_hash() is how the golden tests prove that.
+
+ tick() is one fixed step of the whole simulation. it keeps the grey noise value of
+ every cell in shades, so the perlin background can be drawn from the last step
+ without evaluating the noise again.
+
+ with a generator attached tick() stops filling the flow field itself - it asks the
+ generator for the next field and steps the particles on the newest field that has
+ been published, without waiting (see flow_field_generator). which field a step sees
+ then depends on timing, so the golden tests and headless runs stay synchronous.
+
+ with a playback sequence attached tick() reads the field for each step from a baked
+ file instead (see field_sequence) and no noise is evaluated at all.
+
+ with a world attached the grid is a window onto an unbounded field (see chunked_field)
+ at camera_x, camera_y cells. pan() moves the camera at the next tick - the particles
+ are moved back by the same amount so they stay put in the world, and keep wrapping at
+ the edges of the window.
+
+ resize_particles() and regrid() change the particle count and the grid divisor of a
+ running simulation (see quality_controller). particles past the new count are dropped,
+ new ones start at random places drawn from random(). a regrid fills the new field
+ straight away so the next step has one to move on.
+
+ with a lifetime set every particle lives for between half and one and a half times
+ that many steps, then is born again wherever the emitter puts it. the particles are a
+ fixed pool - a particle that dies frees its slot and the one born in the same step
+ takes it, so the set stays dense and nothing is allocated. each chunk of the parallel
+ update collects its own dead in its own slice of free_slots, has the emitter write the
+ new positions into its own slice of spawn_positions and fills its own slots from them,
+ so no chunk waits on another. every chunk draws from its own random stream keyed on
+ rng_state, the step and the chunk, so the result is the same for any thread count.
+*/
+
+struct flow_field_generator;
+struct field_buffer;
+struct field_sequence_reader;
+struct chunked_field;
+
+/* read only view of what the render passes need from one step - either straight onto
+ a simulation or onto a copy of one (see sim_pipeline).
+*/
+
+struct sim_view {
+    int width;
+    int height;
+    int grid_width;
+    int grid_height;
+    particle const *particles;
+    std::size_t particle_count;
+    djc::math::vec2f const *flow_field;
+    std::uint8_t const *shades;
+    std::uint64_t steps;
+
+    void write_perlin_pixels(std::uint32_t *pixels, int pitch) const noexcept;
+};
+
+struct simulation {
+    static constexpr float flow_strength = 20.0f; // length of every flow field vector
+
+    int width;
+    int height;
+    int grid_divisor;
+    int grid_width;
+    int grid_height;
+    unsigned int seed;
+    djc::math::perlin<double> noisy;
+    std::vector<djc::math::vec2f> flow_field;
+    std::vector<particle> particles;
+    std::vector<std::uint8_t> shades;
+    double zstep;
+    std::uint64_t steps;
+    std::uint64_t rng_state;         // random stream for anything random once the simulation is running
+    flow_field_generator *generator; // null when the flow field is filled in tick()
+    field_buffer const *generated;   // the generated field the last tick stepped on
+    field_sequence_reader *playback; // null unless the fields come from a baked sequence
+    chunked_field *world;            // null for the one screen field
+    std::uint32_t lifetime;          // mean particle lifetime in steps, 0 lives forever
+    particle_emitter emitter;        // where particles are born again
+    std::vector<std::uint32_t> free_slots;          // per chunk, the particles that died this step
+    std::vector<djc::math::vec2f> spawn_positions;  // per chunk, where they are born again
+    std::int64_t camera_x;           // window origin in world cells
+    std::int64_t camera_y;
+    int pan_x;                       // cells to move the camera by at the next tick
+    int pan_y;
+
+    simulation(int width, int height, int grid_divisor, std::size_t particle_count, unsigned int seed = 227) noexcept(false);
+
+    void update_particles(thread_pool *workers = nullptr);
+    void update_flow_field(std::uint32_t *pixels, int pitch, thread_pool *workers = nullptr); // pixels can be null
+    void fill_flow_field(double z, djc::math::vec2f *field, std::uint8_t *field_shades, std::uint32_t *pixels, int pitch, thread_pool *workers) const;
+    void step() noexcept;
+    void pan(int cells_x, int cells_y) noexcept;
+    void move_camera(thread_pool *workers = nullptr); // applies pan
+    void resize_particles(std::size_t count);
+    void regrid(int divisor, thread_pool *workers = nullptr); // not with a world or a playback attached
+    void tick(thread_pool *workers = nullptr); // update_particles, update_flow_field (or playback), step
+    std::uint32_t random() noexcept; // next value from rng_state
+
+    djc::math::vec2f const *current_flow_field() const noexcept;
+    std::uint8_t const *current_shades() const noexcept;
+    sim_view view() const noexcept;
+    std::uint64_t state_hash() const noexcept; // fnv-1a over the bits of the particles, flow field and zstep
+};
+
+#endif // simulation_hpp
@@ -0,0 +1,307 @@
+#include "snapshot.hpp"
+
+// std
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+
+// posix
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// dependancies
+#include "SDL2/SDL.h"
+
+namespace {
+
+constexpr char snapshot_magic[8] = {'P', 'F', 'F', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t snapshot_version = 3;
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+constexpr std::size_t section_alignment = 64;
+constexpr std::size_t chunk_size = 1 << 16; // particles per job
+
+enum section : std::size_t {
+    position_x,
+    position_y,
+    last_x,
+    last_y,
+    velocity_x,
+    velocity_y,
+    acceleration_x,
+    acceleration_y,
+    age,
+    lifetime,
+    flow_x,
+    flow_y,
+    shades,
+    section_count
+};
+
+struct snapshot_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t header_size;
+    std::int32_t width;
+    std::int32_t height;
+    std::int32_t grid_divisor;
+    std::int32_t grid_width;
+    std::int32_t grid_height;
+    std::uint32_t seed;
+    std::uint32_t reserved;
+    std::uint64_t particle_count;
+    std::uint64_t cell_count;
+    double zstep;
+    std::uint64_t steps;
+    std::uint64_t rng_state;
+    std::int64_t camera_x;
+    std::int64_t camera_y;
+    std::uint64_t file_size;
+    std::uint64_t offsets[section_count];
+};
+
+//------------------------------------------------------------
+std::size_t
+align_up(std::size_t value) noexcept {
+    return (value + section_alignment - 1) & ~(section_alignment - 1);
+}
+
+//------------------------------------------------------------
+// where every section goes for this many particles and cells, returns the file size
+std::uint64_t
+layout(snapshot_header & header) noexcept {
+    std::size_t offset = align_up(sizeof(snapshot_header));
+
+    for (std::size_t s = 0; s < section_count; s++) {
+        std::size_t count = s < flow_x ? header.particle_count : header.cell_count;
+        std::size_t element = s == shades ? 1 : sizeof(float); // ages and lifetimes are uint32, the same size
+        header.offsets[s] = offset;
+        offset = align_up(offset + count * element);
+    }
+
+    return offset;
+}
+
+//------------------------------------------------------------
+void
+for_each_chunk(std::size_t count, thread_pool *workers, std::function<void(std::size_t, std::size_t)> const & job) {
+    std::size_t chunks = (count + chunk_size - 1) / chunk_size;
+    auto run = [&](std::size_t chunk) {
+        job(chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+    };
+
+    if (workers) {
+        workers->parallel_for(chunks, run, "snapshot chunks");
+    } else {
+        for (std::size_t chunk = 0; chunk < chunks; chunk++) run(chunk);
+    }
+}
+
+} // namespace
+
+int save_snapshot(simulation const & sim, char const *path, thread_pool *workers) {
+    snapshot_header header{};
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.version = snapshot_version;
+    header.byte_order = byte_order_mark;
+    header.header_size = sizeof(snapshot_header);
+    header.width = sim.width;
+    header.height = sim.height;
+    header.grid_divisor = sim.grid_divisor;
+    header.grid_width = sim.grid_width;
+    header.grid_height = sim.grid_height;
+    header.seed = sim.seed;
+    header.particle_count = sim.particles.size();
+    header.cell_count = sim.flow_field.size();
+    header.zstep = sim.zstep;
+    header.steps = sim.steps;
+    header.rng_state = sim.rng_state;
+    header.camera_x = sim.camera_x;
+    header.camera_y = sim.camera_y;
+    header.file_size = layout(header);
+
+    // written next to the real file and renamed over it once it is complete
+    std::string temporary = std::string(path) + ".tmp";
+    int fd = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not create snapshot \"%s\": %s", temporary.c_str(), std::strerror(errno));
+        return -1;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(header.file_size)) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not size snapshot \"%s\": %s", temporary.c_str(), std::strerror(errno));
+        ::close(fd);
+        ::unlink(temporary.c_str());
+        return -1;
+    }
+
+    void *mapping = mmap(nullptr, header.file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (mapping == MAP_FAILED) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not map snapshot \"%s\": %s", temporary.c_str(), std::strerror(errno));
+        ::close(fd);
+        ::unlink(temporary.c_str());
+        return -1;
+    }
+
+    unsigned char *base = static_cast<unsigned char *>(mapping);
+    std::memcpy(base, &header, sizeof(header));
+
+    float *columns[section_count];
+
+    for (std::size_t s = 0; s < section_count; s++) {
+        columns[s] = reinterpret_cast<float *>(base + header.offsets[s]);
+    }
+
+    for_each_chunk(sim.particles.size(), workers, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            particle const & p = sim.particles[i];
+            columns[position_x][i] = p.current_position.x;
+            columns[position_y][i] = p.current_position.y;
+            columns[last_x][i] = p.last_position.x;
+            columns[last_y][i] = p.last_position.y;
+            columns[velocity_x][i] = p.velocity.x;
+            columns[velocity_y][i] = p.velocity.y;
+            columns[acceleration_x][i] = p.acceleration.x;
+            columns[acceleration_y][i] = p.acceleration.y;
+            reinterpret_cast<std::uint32_t *>(columns[age])[i] = p.age;
+            reinterpret_cast<std::uint32_t *>(columns[lifetime])[i] = p.lifetime;
+        }
+    });
+
+    djc::math::vec2f const *field = sim.current_flow_field();
+
+    for (std::size_t i = 0; i < sim.flow_field.size(); i++) {
+        columns[flow_x][i] = field[i].x;
+        columns[flow_y][i] = field[i].y;
+    }
+
+    std::memcpy(base + header.offsets[shades], sim.current_shades(), sim.flow_field.size());
+
+    bool ok = msync(mapping, header.file_size, MS_SYNC) == 0;
+    int error = errno;
+    munmap(mapping, header.file_size);
+    ok = ::close(fd) == 0 && ok;
+
+    if (!ok || std::rename(temporary.c_str(), path) != 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not write snapshot \"%s\": %s", path, std::strerror(ok ? errno : error));
+        ::unlink(temporary.c_str());
+        return -1;
+    }
+
+    return 0;
+}
+
+int load_snapshot(simulation & sim, char const *path, thread_pool *workers) {
+    int fd = ::open(path, O_RDONLY);
+
+    if (fd < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open snapshot \"%s\": %s", path, std::strerror(errno));
+        return -1;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) < 0 || static_cast<std::size_t>(info.st_size) < sizeof(snapshot_header)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "\"%s\" is too small to be a snapshot", path);
+        ::close(fd);
+        return -1;
+    }
+
+    std::size_t file_size = static_cast<std::size_t>(info.st_size);
+    void *mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+
+    if (mapping == MAP_FAILED) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not map snapshot \"%s\": %s", path, std::strerror(errno));
+        return -1;
+    }
+
+    // read ahead the whole file and drop pages behind the copy
+    madvise(mapping, file_size, MADV_SEQUENTIAL);
+    madvise(mapping, file_size, MADV_WILLNEED);
+
+    unsigned char const *base = static_cast<unsigned char const *>(mapping);
+    snapshot_header header;
+    std::memcpy(&header, base, sizeof(header));
+
+    // everything the offsets are about to be trusted for
+    snapshot_header expected = header;
+    char const *error = nullptr;
+
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0) {
+        error = "not a snapshot";
+    } else if (header.byte_order != byte_order_mark) {
+        error = "written on a machine with a different byte order";
+    } else if (header.version != snapshot_version || header.header_size != sizeof(snapshot_header)) {
+        error = "unsupported snapshot version";
+    } else if (header.particle_count > file_size / sizeof(float) || header.cell_count > file_size / sizeof(float)) {
+        // no section can be bigger than the file, which keeps layout() from overflowing
+        error = "truncated or corrupt";
+    } else if (layout(expected) != header.file_size || header.file_size > file_size
+               || std::memcmp(expected.offsets, header.offsets, sizeof(header.offsets)) != 0) {
+        error = "truncated or corrupt";
+    } else if (header.width != sim.width || header.height != sim.height) {
+        error = "taken with a different width or height";
+    } else if (header.grid_divisor <= 0 || header.grid_width != sim.width / header.grid_divisor || header.grid_height != sim.height / header.grid_divisor
+               || header.cell_count != static_cast<std::uint64_t>(header.grid_width) * header.grid_height) {
+        error = "truncated or corrupt";
+    }
+
+    if (error) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not load snapshot \"%s\": %s", path, error);
+        munmap(mapping, file_size);
+        return -1;
+    }
+
+    float const *columns[section_count];
+
+    for (std::size_t s = 0; s < section_count; s++) {
+        columns[s] = reinterpret_cast<float const *>(base + header.offsets[s]);
+    }
+
+    // taken after the grid was changed for quality
+    if (header.grid_divisor != sim.grid_divisor) {
+        sim.regrid(header.grid_divisor, workers);
+    }
+
+    sim.particles.resize(header.particle_count, particle(djc::math::vec2f(0, 0)));
+
+    for_each_chunk(sim.particles.size(), workers, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            particle & p = sim.particles[i];
+            p.current_position = djc::math::vec2f(columns[position_x][i], columns[position_y][i]);
+            p.last_position = djc::math::vec2f(columns[last_x][i], columns[last_y][i]);
+            p.velocity = djc::math::vec2f(columns[velocity_x][i], columns[velocity_y][i]);
+            p.acceleration = djc::math::vec2f(columns[acceleration_x][i], columns[acceleration_y][i]);
+            p.age = reinterpret_cast<std::uint32_t const *>(columns[age])[i];
+            p.lifetime = reinterpret_cast<std::uint32_t const *>(columns[lifetime])[i];
+        }
+    });
+
+    for (std::size_t i = 0; i < sim.flow_field.size(); i++) {
+        sim.flow_field[i] = djc::math::vec2f(columns[flow_x][i], columns[flow_y][i]);
+    }
+
+    std::memcpy(sim.shades.data(), base + header.offsets[shades], sim.shades.size());
+    munmap(mapping, file_size);
+
+    if (header.seed != sim.seed) {
+        sim.seed = header.seed;
+        sim.noisy = djc::math::perlin<double>(header.seed);
+    }
+
+    sim.zstep = header.zstep;
+    sim.steps = header.steps;
+    sim.rng_state = header.rng_state;
+    sim.camera_x = header.camera_x;
+    sim.camera_y = header.camera_y;
+    sim.generated = nullptr;
+    return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef snapshot_hpp
+#define snapshot_hpp
+
+// std
+#include <cstdint>
+
+// my
+#include "simulation.hpp"
+#include "thread_pool.hpp"
+
+/* checkpoint / restore of the whole simulation in a versioned binary file.
+
+ layout - a fixed header, then every array on a 64 byte boundary:
+
+    header          magic, version, byte order mark, sizes, seed, zstep, steps,
+                    rng state, camera position (for a world) and the offset of
+                    every section below
+    particles       8 float arrays of particle_count (structure of arrays):
+                    position x / y, last position x / y, velocity x / y,
+                    acceleration x / y, then 2 uint32 arrays - age, lifetime
+    flow field      2 float arrays of cell_count (x / y)
+    shades          cell_count bytes
+
+ the file is written through a shared mapping and msync'd, to a temporary name
+ that is renamed over the old one, so a crash never leaves a half written
+ checkpoint behind. loading maps the file and copies the sections straight into
+ the simulation, split over the thread pool - no parsing, so tens of millions of
+ particles restore in about the time it takes to touch the memory.
+
+ the sizes in the header are checked against the size of the file before anything is
+ laid out from them, so a corrupt or crafted count can not wrap the section offsets
+ round into ones that look valid.
+
+ a snapshot only loads into a simulation of the same width and height, one taken at
+ another grid divisor regrids the simulation to it. both return -1 after logging the
+ reason on failure.
+*/
+
+int save_snapshot(simulation const & sim, char const *path, thread_pool *workers = nullptr);
+int load_snapshot(simulation & sim, char const *path, thread_pool *workers = nullptr);
+
+#endif // snapshot_hpp
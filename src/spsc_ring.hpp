@@ -0,0 +1,48 @@
+#ifndef spsc_ring_hpp
+#define spsc_ring_hpp
+
+// std
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/* fixed size lock free queue between exactly one producer thread and one consumer
+ thread. push() fails when full and pop() fails when empty - neither ever blocks or
+ allocates, waiting (if any) is up to the caller. capacity has to be a power of two.
+*/
+
+template<typename T, std::size_t Capacity>
+struct spsc_ring {
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    bool push(T const & value) noexcept {
+        std::size_t h = m_head.load(std::memory_order_relaxed);
+
+        if (h - m_tail.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+
+        m_slots[h & (Capacity - 1)] = value;
+        m_head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T & value) noexcept {
+        std::size_t t = m_tail.load(std::memory_order_relaxed);
+
+        if (t == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        value = m_slots[t & (Capacity - 1)];
+        m_tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> m_slots{};
+    alignas(64) std::atomic<std::size_t> m_head{0}; // next write, only the producer stores
+    alignas(64) std::atomic<std::size_t> m_tail{0}; // next read, only the consumer stores
+};
+
+#endif // spsc_ring_hpp
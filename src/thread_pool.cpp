@@ -0,0 +1,111 @@
+#include "thread_pool.hpp"
+#include "tracer.hpp"
+
+thread_pool::thread_pool(std::size_t worker_count) noexcept(false)
+:   m_workers{}
+,   m_mutex{}
+,   m_wake{}
+,   m_done{}
+,   m_job{nullptr}
+,   m_name{""}
+,   m_count{0}
+,   m_next{0}
+,   m_busy{0}
+,   m_generation{0}
+,   m_stop{false} {
+
+    m_workers.reserve(worker_count);
+    
+    for (std::size_t i = 0; i < worker_count; i++) {
+        m_workers.emplace_back(&thread_pool::worker_loop, this);
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread & worker : m_workers) {
+        worker.join();
+    }
+}
+
+void thread_pool::parallel_for(std::size_t count, std::function<void(std::size_t)> const & job, char const *name) {
+    if (count == 0) {
+        return;
+    }
+
+    // not worth waking anyone for a single job
+    if (m_workers.empty() || count == 1) {
+        trace_scope trace(name);
+
+        for (std::size_t i = 0; i < count; i++) {
+            job(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_name = name;
+        m_count = count;
+        m_next.store(0, std::memory_order_relaxed);
+        m_busy = m_workers.size();
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    run_jobs();
+
+    // the job lives on the callers stack so wait for every worker to let go of it
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_job = nullptr;
+}
+
+std::size_t thread_pool::thread_count() const noexcept {
+    return m_workers.size() + 1;
+}
+
+std::size_t thread_pool::default_worker_count() noexcept {
+    unsigned int hardware = std::thread::hardware_concurrency();
+    return hardware > 1 ? hardware - 1 : 0;
+}
+
+void thread_pool::worker_loop() {
+    std::size_t seen_generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen_generation; });
+            
+            if (m_stop) {
+                return;
+            }
+            
+            seen_generation = m_generation;
+        }
+
+        run_jobs();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy--;
+        }
+        m_done.notify_one();
+    }
+}
+
+void thread_pool::run_jobs() {
+    std::function<void(std::size_t)> const & job = *m_job;
+    trace_scope trace(m_name);
+
+    for (std::size_t i = m_next.fetch_add(1, std::memory_order_relaxed); i < m_count; i = m_next.fetch_add(1, std::memory_order_relaxed)) {
+        job(i);
+    }
+}
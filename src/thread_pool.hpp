@@ -0,0 +1,51 @@
+#ifndef thread_pool_hpp
+#define thread_pool_hpp
+
+// std
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+/* fixed set of worker threads that split an index range between them.
+
+ parallel_for(count, job) runs job(i) for every i in [0, count) and returns once
+ all of them are done. the calling thread takes part in the work, so a pool made
+ with 0 workers just runs the loop inline. indices are handed out one at a time
+ from an atomic counter, which keeps uneven jobs (e.g. busy screen tiles) balanced.
+ each threads share of a parallel_for shows up in the trace under name.
+*/
+
+struct thread_pool {
+    explicit thread_pool(std::size_t worker_count = default_worker_count()) noexcept(false);
+    ~thread_pool();
+
+    thread_pool(thread_pool const &) = delete;
+    thread_pool & operator = (thread_pool const &) = delete;
+
+    void parallel_for(std::size_t count, std::function<void(std::size_t)> const & job, char const *name = "parallel for");
+    std::size_t thread_count() const noexcept;
+
+    static std::size_t default_worker_count() noexcept;
+
+private:
+    void worker_loop();
+    void run_jobs();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    std::function<void(std::size_t)> const * m_job;
+    char const * m_name;
+    std::size_t m_count;
+    std::atomic<std::size_t> m_next;
+    std::size_t m_busy;
+    std::size_t m_generation;
+    bool m_stop;
+};
+
+#endif // thread_pool_hpp
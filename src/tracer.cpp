@@ -0,0 +1,142 @@
+#include "tracer.hpp"
+
+// std
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// dependancies
+#include "SDL2/SDL.h"
+
+namespace {
+
+struct trace_event {
+    char const *name;
+    std::int64_t begin_ns;
+    std::int64_t duration_ns;
+};
+
+// written only by its owning thread, count is published with release so the writer sees whole events
+struct thread_events {
+    static constexpr std::size_t capacity = 1 << 18;
+
+    thread_events(int tid, bool main) : events(capacity), count{0}, dropped{0}, tid{tid}, main{main} {}
+
+    std::vector<trace_event> events;
+    std::atomic<std::size_t> count;
+    std::atomic<std::uint64_t> dropped;
+    int tid;
+    bool main;
+};
+
+std::atomic<bool> g_enabled{false};
+std::thread::id g_main_thread; // whoever enabled the tracer
+std::chrono::steady_clock::time_point const g_epoch = std::chrono::steady_clock::now();
+std::mutex g_threads_mutex;
+std::vector<std::unique_ptr<thread_events>> g_threads;
+
+//------------------------------------------------------------
+thread_events &
+this_thread_events() {
+    thread_local thread_events *events = [] {
+        std::lock_guard<std::mutex> lock(g_threads_mutex);
+        g_threads.push_back(std::make_unique<thread_events>(static_cast<int>(g_threads.size()), std::this_thread::get_id() == g_main_thread));
+        return g_threads.back().get();
+    }();
+
+    return *events;
+}
+
+//------------------------------------------------------------
+std::int64_t
+since_epoch_ns(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time - g_epoch).count();
+}
+
+} // namespace
+
+void tracer_enable(bool enable) noexcept {
+    if (enable) {
+        g_main_thread = std::this_thread::get_id();
+    }
+    g_enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool tracer_enabled() noexcept {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void tracer_record(char const *name, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) noexcept {
+    thread_events & thread = this_thread_events();
+    std::size_t index = thread.count.load(std::memory_order_relaxed);
+
+    if (index == thread_events::capacity) {
+        thread.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    thread.events[index] = trace_event{name, since_epoch_ns(begin), since_epoch_ns(end) - since_epoch_ns(begin)};
+    thread.count.store(index + 1, std::memory_order_release);
+}
+
+int tracer_write(char const *path) {
+    std::FILE *file = std::fopen(path, "wb");
+
+    if (file == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open trace file \"%s\"", path);
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(g_threads_mutex);
+    std::uint64_t dropped = 0;
+    bool first = true;
+
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+
+    for (std::unique_ptr<thread_events> & thread : g_threads) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+            first ? "" : ",\n", thread->tid, thread->main ? "main" : "worker", thread->tid);
+        first = false;
+
+        std::size_t count = thread->count.load(std::memory_order_acquire);
+        
+        for (std::size_t i = 0; i < count; i++) {
+            trace_event const & event = thread->events[i];
+            
+            // trace event timestamps are in microseconds
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                event.name, thread->tid, event.begin_ns / 1000.0, event.duration_ns / 1000.0);
+        }
+
+        dropped += thread->dropped.load(std::memory_order_relaxed);
+    }
+
+    std::fputs("\n]}\n", file);
+    
+    if (std::fclose(file) != 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not write trace file \"%s\"", path);
+        return -1;
+    }
+
+    if (dropped) {
+        SDL_Log("trace buffers were full, %llu events dropped", static_cast<unsigned long long>(dropped));
+    }
+
+    return 0;
+}
+
+trace_scope::trace_scope(char const *name) noexcept
+:   name{name}
+,   active{tracer_enabled()}
+,   start{active ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}} {
+
+}
+
+trace_scope::~trace_scope() {
+    if (active) {
+        tracer_record(name, start, std::chrono::steady_clock::now());
+    }
+}
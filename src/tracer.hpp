@@ -0,0 +1,35 @@
+#ifndef tracer_hpp
+#define tracer_hpp
+
+// std
+#include <chrono>
+#include <cstdint>
+
+/* timeline tracing in the chrome trace event format (chrome://tracing, ui.perfetto.dev).
+
+ every trace_scope becomes one complete ("ph":"X") event - its begin time and
+ duration - appended to a fixed size buffer owned by the calling thread, so
+ recording is a couple of stores and no locks. names must be string literals (or
+ otherwise outlive the tracer) because only the pointer is stored.
+
+ tracer_write() dumps every threads events as json, call it once the workers are idle.
+*/
+
+void tracer_enable(bool enable) noexcept;
+bool tracer_enabled() noexcept;
+void tracer_record(char const *name, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) noexcept;
+int tracer_write(char const *path);
+
+struct trace_scope {
+    explicit trace_scope(char const *name) noexcept;
+    ~trace_scope();
+
+    trace_scope(trace_scope const &) = delete;
+    trace_scope & operator = (trace_scope const &) = delete;
+
+    char const *name;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // tracer_hpp
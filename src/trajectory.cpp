@@ -0,0 +1,485 @@
+#include "trajectory.hpp"
+
+// std
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+// my
+#include "tracer.hpp"
+
+// posix
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// dependancies
+#include "SDL2/SDL.h"
+
+namespace {
+
+constexpr char trajectory_magic[8] = {'P', 'F', 'F', 'T', 'R', 'A', 'J', '\0'};
+constexpr std::uint32_t trajectory_version = 1;
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+constexpr std::size_t block_header_size = sizeof(std::uint64_t); // the step
+constexpr std::size_t chunk_size = 1 << 14; // particles per job
+
+struct trajectory_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t encoding;
+    std::uint32_t stride;
+    std::uint32_t every;
+    std::int32_t width;
+    std::int32_t height;
+    std::uint32_t reserved;
+    std::uint64_t particle_count;
+    std::uint64_t block_size;
+    std::uint64_t reserved_2;
+};
+
+static_assert(sizeof(trajectory_header) == 64, "the frame blocks start at byte 64");
+
+//------------------------------------------------------------
+std::size_t
+element_size(trajectory_encoding encoding) noexcept {
+    return encoding == trajectory_encoding::int16 ? sizeof(std::int16_t) : sizeof(float);
+}
+
+//------------------------------------------------------------
+std::uint64_t
+block_size(trajectory_encoding encoding, std::size_t count) noexcept {
+    return block_header_size + 2 * count * element_size(encoding);
+}
+
+//------------------------------------------------------------
+// 0 .. extent onto the whole int16 range
+std::int16_t
+quantize(float value, float scale) noexcept {
+    float unit = std::clamp(value * scale, 0.0f, 65535.0f);
+    return static_cast<std::int16_t>(static_cast<std::int32_t>(unit + 0.5f) - 32768); // rounds, unit is never negative
+}
+
+//------------------------------------------------------------
+bool
+write_all(int fd, std::uint8_t const *data, std::size_t size) noexcept {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------
+bool
+read_all(int fd, std::uint8_t *data, std::size_t size, std::uint64_t offset) noexcept {
+    while (size > 0) {
+        ssize_t count = ::pread(fd, data, size, static_cast<off_t>(offset));
+
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        if (count == 0) {
+            return false;
+        }
+
+        data += count;
+        size -= static_cast<std::size_t>(count);
+        offset += static_cast<std::uint64_t>(count);
+    }
+
+    return true;
+}
+
+} // namespace
+
+trajectory_recorder::trajectory_recorder() noexcept
+:   m_encoding{trajectory_encoding::float32}
+,   m_fd{-1}
+,   m_width{0}
+,   m_height{0}
+,   m_source_count{0}
+,   m_count{0}
+,   m_stride{1}
+,   m_every{1}
+,   m_next_step{0}
+,   m_front{}
+,   m_back{}
+,   m_mutex{}
+,   m_wake{}
+,   m_idle{}
+,   m_pending{false}
+,   m_stop{false}
+,   m_failed{false}
+,   m_frames_written{0}
+,   m_frames_dropped{0}
+,   m_writer{} {
+
+}
+
+trajectory_recorder::~trajectory_recorder() {
+    close();
+}
+
+int trajectory_recorder::open(char const *path, char const *encoding_name, int width, int height, std::size_t particle_count, int every, int stride) noexcept(false) {
+    if (is_open()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "trajectory recording is already open");
+        return -1;
+    }
+
+    if (!encoding_name || std::strcmp(encoding_name, "float") == 0) {
+        m_encoding = trajectory_encoding::float32;
+    } else if (std::strcmp(encoding_name, "int16") == 0) {
+        m_encoding = trajectory_encoding::int16;
+    } else {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "unknown trajectory format \"%s\" (float or int16)", encoding_name);
+        return -1;
+    }
+
+    if (every < 1 || stride < 1) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "trajectory every and stride have to be at least 1");
+        return -1;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_source_count = particle_count;
+    m_stride = static_cast<std::size_t>(stride);
+    m_count = (particle_count + m_stride - 1) / m_stride;
+    m_every = static_cast<std::uint64_t>(every);
+
+    trajectory_header header{};
+    std::memcpy(header.magic, trajectory_magic, sizeof(header.magic));
+    header.version = trajectory_version;
+    header.byte_order = byte_order_mark;
+    header.encoding = static_cast<std::uint32_t>(m_encoding);
+    header.stride = static_cast<std::uint32_t>(stride);
+    header.every = static_cast<std::uint32_t>(every);
+    header.width = width;
+    header.height = height;
+    header.particle_count = m_count;
+    header.block_size = block_size(m_encoding, m_count);
+
+    m_fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (m_fd < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open trajectory output \"%s\": %s", path, std::strerror(errno));
+        return -1;
+    }
+
+    if (!write_all(m_fd, reinterpret_cast<std::uint8_t const *>(&header), sizeof(header))) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not write to trajectory output \"%s\": %s", path, std::strerror(errno));
+        ::close(m_fd);
+        m_fd = -1;
+        return -1;
+    }
+
+    // both buffers up front, record() never allocates
+    m_front.assign(header.block_size, 0);
+    m_back.assign(header.block_size, 0);
+    m_next_step = 0;
+    m_pending = false;
+    m_stop = false;
+    m_failed.store(false);
+    m_frames_written = 0;
+    m_frames_dropped = 0;
+    m_writer = std::thread(&trajectory_recorder::writer_loop, this);
+    return 0;
+}
+
+int trajectory_recorder::record(sim_view const & view, thread_pool *workers) noexcept {
+    if (!is_open() || m_failed.load(std::memory_order_relaxed)) {
+        return -1;
+    }
+
+    if (view.particle_count != m_source_count) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "trajectory: the particle count changed from %zu to %zu, stopping",
+                     m_source_count, view.particle_count);
+        m_failed.store(true);
+        return -1;
+    }
+
+    // every is counted in steps, a frame drawn again from the same step is not a new one
+    if (view.steps < m_next_step) {
+        return 0;
+    }
+
+    m_next_step = view.steps + m_every;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_pending) {
+            m_frames_dropped++;
+            return 0;
+        }
+    }
+
+    trace_scope trace("trajectory record");
+
+    // the back buffer is only ever touched here, the writer has the front one
+    std::memcpy(m_back.data(), &view.steps, block_header_size);
+
+    std::uint8_t *columns = m_back.data() + block_header_size;
+    std::size_t column_size = m_count * element_size(m_encoding);
+    std::size_t chunks = (m_count + chunk_size - 1) / chunk_size;
+
+    auto gather = [&](std::size_t chunk) {
+        std::size_t begin = chunk * chunk_size;
+        std::size_t end = std::min(m_count, begin + chunk_size);
+
+        if (m_encoding == trajectory_encoding::float32) {
+            float *xs = reinterpret_cast<float *>(columns);
+            float *ys = reinterpret_cast<float *>(columns + column_size);
+
+            for (std::size_t i = begin; i < end; i++) {
+                djc::math::vec2f const & position = view.particles[i * m_stride].current_position;
+                xs[i] = position.x;
+                ys[i] = position.y;
+            }
+        } else {
+            std::int16_t *xs = reinterpret_cast<std::int16_t *>(columns);
+            std::int16_t *ys = reinterpret_cast<std::int16_t *>(columns + column_size);
+            float x_scale = 65535.0f / m_width;
+            float y_scale = 65535.0f / m_height;
+
+            for (std::size_t i = begin; i < end; i++) {
+                djc::math::vec2f const & position = view.particles[i * m_stride].current_position;
+                xs[i] = quantize(position.x, x_scale);
+                ys[i] = quantize(position.y, y_scale);
+            }
+        }
+    };
+
+    if (workers) {
+        workers->parallel_for(chunks, gather, "trajectory chunks");
+    } else {
+        for (std::size_t chunk = 0; chunk < chunks; chunk++) gather(chunk);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_front.swap(m_back);
+        m_pending = true;
+    }
+    m_wake.notify_one();
+    return 0;
+}
+
+void trajectory_recorder::flush() noexcept {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return !m_pending; });
+}
+
+void trajectory_recorder::close() noexcept {
+    if (!is_open()) {
+        return;
+    }
+
+    // the writer finishes the block it has before it stops
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_writer.join();
+
+    ::close(m_fd);
+    m_fd = -1;
+
+    m_front.clear();
+    m_front.shrink_to_fit();
+    m_back.clear();
+    m_back.shrink_to_fit();
+    SDL_Log("trajectory: wrote %llu frames, dropped %llu",
+            static_cast<unsigned long long>(m_frames_written), static_cast<unsigned long long>(m_frames_dropped));
+}
+
+bool trajectory_recorder::is_open() const noexcept {
+    return m_writer.joinable();
+}
+
+bool trajectory_recorder::failed() const noexcept {
+    return m_failed.load(std::memory_order_relaxed);
+}
+
+void trajectory_recorder::writer_loop() noexcept {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_pending || m_stop; });
+
+            if (!m_pending) {
+                return;
+            }
+        }
+
+        if (!m_failed.load(std::memory_order_relaxed)) {
+            trace_scope trace("trajectory write");
+
+            if (write_all(m_fd, m_front.data(), m_front.size())) {
+                m_frames_written++;
+            } else {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "trajectory: writing frame %llu failed (%s), stopping",
+                             static_cast<unsigned long long>(m_frames_written), std::strerror(errno));
+                m_failed.store(true);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending = false;
+        }
+        m_idle.notify_all();
+    }
+}
+
+trajectory_reader::trajectory_reader() noexcept
+:   m_fd{-1}
+,   m_encoding{trajectory_encoding::float32}
+,   m_width{0}
+,   m_height{0}
+,   m_stride{1}
+,   m_every{1}
+,   m_count{0}
+,   m_block_size{0}
+,   m_frame_count{0}
+,   m_block{} {
+
+}
+
+trajectory_reader::~trajectory_reader() {
+    close();
+}
+
+int trajectory_reader::open(char const *path) noexcept {
+    close();
+    m_fd = ::open(path, O_RDONLY);
+
+    if (m_fd < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open trajectory \"%s\": %s", path, std::strerror(errno));
+        return -1;
+    }
+
+    trajectory_header header;
+    struct stat info;
+    char const *error = nullptr;
+
+    if (!read_all(m_fd, reinterpret_cast<std::uint8_t *>(&header), sizeof(header), 0) || fstat(m_fd, &info) < 0) {
+        error = "too small to be a trajectory";
+    } else if (std::memcmp(header.magic, trajectory_magic, sizeof(header.magic)) != 0) {
+        error = "not a trajectory";
+    } else if (header.byte_order != byte_order_mark) {
+        error = "written on a machine with a different byte order";
+    } else if (header.version != trajectory_version || header.encoding > static_cast<std::uint32_t>(trajectory_encoding::int16)) {
+        error = "unsupported trajectory version";
+    } else if (header.width <= 0 || header.height <= 0
+               || header.block_size != block_size(static_cast<trajectory_encoding>(header.encoding), header.particle_count)) {
+        error = "corrupt header";
+    }
+
+    if (error) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not open trajectory \"%s\": %s", path, error);
+        close();
+        return -1;
+    }
+
+    m_encoding = static_cast<trajectory_encoding>(header.encoding);
+    m_width = header.width;
+    m_height = header.height;
+    m_stride = static_cast<int>(header.stride);
+    m_every = static_cast<int>(header.every);
+    m_count = header.particle_count;
+    m_block_size = header.block_size;
+
+    // a recording that was cut short ends at its last whole block
+    m_frame_count = (static_cast<std::uint64_t>(info.st_size) - sizeof(header)) / m_block_size;
+    return 0;
+}
+
+void trajectory_reader::close() noexcept {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+
+    m_fd = -1;
+    m_count = 0;
+    m_frame_count = 0;
+}
+
+int trajectory_reader::read_frame(std::uint64_t frame, std::uint64_t & step, float *x, float *y) noexcept(false) {
+    if (frame >= m_frame_count) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "trajectory frame %llu is past the end (%llu frames)",
+                     static_cast<unsigned long long>(frame), static_cast<unsigned long long>(m_frame_count));
+        return -1;
+    }
+
+    m_block.resize(m_block_size);
+
+    if (!read_all(m_fd, m_block.data(), m_block_size, sizeof(trajectory_header) + frame * m_block_size)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not read trajectory frame %llu: %s",
+                     static_cast<unsigned long long>(frame), std::strerror(errno));
+        return -1;
+    }
+
+    std::memcpy(&step, m_block.data(), block_header_size);
+
+    std::uint8_t const *columns = m_block.data() + block_header_size;
+    std::size_t column_size = m_count * element_size(m_encoding);
+
+    if (m_encoding == trajectory_encoding::float32) {
+        std::memcpy(x, columns, column_size);
+        std::memcpy(y, columns + column_size, column_size);
+    } else {
+        std::int16_t const *xs = reinterpret_cast<std::int16_t const *>(columns);
+        std::int16_t const *ys = reinterpret_cast<std::int16_t const *>(columns + column_size);
+        float x_scale = m_width / 65535.0f;
+        float y_scale = m_height / 65535.0f;
+
+        for (std::size_t i = 0; i < m_count; i++) {
+            x[i] = (xs[i] + 32768) * x_scale;
+            y[i] = (ys[i] + 32768) * y_scale;
+        }
+    }
+
+    return 0;
+}
+
+std::uint64_t trajectory_reader::frame_count() const noexcept {
+    return m_frame_count;
+}
+
+std::size_t trajectory_reader::particle_count() const noexcept {
+    return m_count;
+}
+
+trajectory_encoding trajectory_reader::encoding() const noexcept {
+    return m_encoding;
+}
+
+int trajectory_reader::width() const noexcept {
+    return m_width;
+}
+
+int trajectory_reader::height() const noexcept {
+    return m_height;
+}
+
+int trajectory_reader::stride() const noexcept {
+    return m_stride;
+}
+
+int trajectory_reader::every() const noexcept {
+    return m_every;
+}
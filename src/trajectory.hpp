@@ -0,0 +1,129 @@
+#ifndef trajectory_hpp
+#define trajectory_hpp
+
+// std
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// my
+#include "simulation.hpp"
+#include "thread_pool.hpp"
+
+/* particle positions over time, for looking at offline.
+
+ the file is columnar and append only - a 64 byte header, then one fixed size block
+ per recorded frame:
+
+    header          magic, version, byte order mark, encoding, stride, every,
+                    width, height, particles per frame, block size
+    frame block     the simulation step (8 bytes), then every x, then every y
+
+ positions are float32, or 16 bit fixed point over the width / height (about 0.01 of a
+ pixel at 1280 wide, half the size, and the few particles a step past an edge before
+ they wrap are clamped to it). every keeps one step in n - a step is recorded once
+ however many frames show it, and only the steps that are drawn are seen, so with
+ substeps the kept ones can be further apart - and stride keeps one particle in n, always the same ones so a particle stays in the same column - which is
+ why the particles can not be given a lifetime while recording, a particle born again
+ would carry on in the column of the one that died. with the
+ blocks all the same size a reader finds any frame without an index, and a recording
+ cut short by a crash just ends at the last whole block.
+
+ record() copies the positions out of the view into the back buffer (over the thread
+ pool, converting on the way) and hands it to a writer thread, which writes the front
+ buffer while the next frames are simulated and drawn. there are only the two buffers -
+ when the writer has not finished with the front one by the next record() that frame is
+ dropped rather than slowing the frame down, and the drops are reported on close. each
+ block keeps its step, so the gaps show up in the file as well. flush() waits for the
+ writer to finish the block it has, for when every block has to make it (the tests).
+*/
+
+enum class trajectory_encoding : std::uint32_t {
+    float32,
+    int16
+};
+
+struct trajectory_recorder {
+    trajectory_recorder() noexcept;
+    ~trajectory_recorder();
+
+    trajectory_recorder(trajectory_recorder const &) = delete;
+    trajectory_recorder & operator = (trajectory_recorder const &) = delete;
+
+    // encoding_name is "float" or "int16", null for float. every and stride are at least 1
+    int open(char const *path, char const *encoding_name, int width, int height, std::size_t particle_count, int every, int stride) noexcept(false);
+    int record(sim_view const & view, thread_pool *workers = nullptr) noexcept;
+    void flush() noexcept;
+    void close() noexcept;
+
+    bool is_open() const noexcept;
+    bool failed() const noexcept;
+
+private:
+    void writer_loop() noexcept;
+
+    trajectory_encoding m_encoding;
+    int m_fd;
+    int m_width;
+    int m_height;
+    std::size_t m_source_count; // particles in the simulation
+    std::size_t m_count;        // particles kept per frame
+    std::size_t m_stride;
+    std::uint64_t m_every;
+    std::uint64_t m_next_step; // the first step that is recorded next
+    std::vector<std::uint8_t> m_front; // the writers
+    std::vector<std::uint8_t> m_back;  // the render threads
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle; // the writer finished a block
+    bool m_pending; // m_front holds a block the writer has not finished writing
+    bool m_stop;
+    std::atomic<bool> m_failed;
+    std::uint64_t m_frames_written;
+    std::uint64_t m_frames_dropped;
+    std::thread m_writer;
+};
+
+/* reads back what trajectory_recorder wrote. positions come back as floats in pixels
+ whatever the encoding. open() and read_frame() return -1 after logging the reason.
+*/
+
+struct trajectory_reader {
+    trajectory_reader() noexcept;
+    ~trajectory_reader();
+
+    trajectory_reader(trajectory_reader const &) = delete;
+    trajectory_reader & operator = (trajectory_reader const &) = delete;
+
+    int open(char const *path) noexcept;
+    void close() noexcept;
+
+    // x and y take particle_count() floats each
+    int read_frame(std::uint64_t frame, std::uint64_t & step, float *x, float *y) noexcept(false);
+
+    std::uint64_t frame_count() const noexcept;
+    std::size_t particle_count() const noexcept;
+    trajectory_encoding encoding() const noexcept;
+    int width() const noexcept;
+    int height() const noexcept;
+    int stride() const noexcept;
+    int every() const noexcept;
+
+private:
+    int m_fd;
+    trajectory_encoding m_encoding;
+    int m_width;
+    int m_height;
+    int m_stride;
+    int m_every;
+    std::size_t m_count;
+    std::uint64_t m_block_size;
+    std::uint64_t m_frame_count;
+    std::vector<std::uint8_t> m_block;
+};
+
+#endif // trajectory_hpp